@@ -116,3 +116,196 @@ int CCycleBuffer::Cover(unsigned char *pdata, int wlen)
 	return Write(pdata, wlen);
 }
 
+
+CSpscCycleBuffer::CSpscCycleBuffer(void)
+{
+	m_buf = NULL;
+	m_size = 0;
+	m_mask = 0;
+	m_head.store(0, std::memory_order_relaxed);
+	m_tail.store(0, std::memory_order_relaxed);
+	m_tailCache = 0;
+	m_headCache = 0;
+	m_waiting.store(false, std::memory_order_relaxed);
+	pthread_mutex_init(&m_mutex, NULL);
+	pthread_cond_init(&m_cond, NULL);
+}
+
+CSpscCycleBuffer::~CSpscCycleBuffer(void)
+{
+	pthread_cond_destroy(&m_cond);
+	pthread_mutex_destroy(&m_mutex);
+
+	if (m_buf)
+	{
+		delete []m_buf;
+		m_buf = NULL;
+	}
+	m_size = 0;
+	m_mask = 0;
+}
+
+bool CSpscCycleBuffer::Init(int len)
+{
+	if (len <= 0 || len > (1 << 30))
+		return false;
+
+	unsigned int size = 1;
+	while (size < (unsigned int)len)
+		size <<= 1;
+
+	if (m_buf)
+		delete []m_buf;
+	m_buf = new unsigned char[size];
+	m_size = size;
+	m_mask = size - 1;
+	Clean();
+	return true;
+}
+
+void CSpscCycleBuffer::Clean()
+{
+	m_head.store(0, std::memory_order_relaxed);
+	m_tail.store(0, std::memory_order_relaxed);
+	m_tailCache = 0;
+	m_headCache = 0;
+}
+
+int CSpscCycleBuffer::GetLength()
+{
+	return (int)(m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire));
+}
+
+int CSpscCycleBuffer::GetFreeLength()
+{
+	return (int)m_size - GetLength();
+}
+
+unsigned char *CSpscCycleBuffer::PeekWrite(int &len)
+{
+	unsigned int head = m_head.load(std::memory_order_relaxed);
+	unsigned int pos = head & m_mask;
+	unsigned int contiguous = m_size - pos; // 到缓冲区尾部的长度
+	unsigned int free = m_size - (head - m_tailCache);
+	if (free < contiguous) // 缓存的读位置可能已经过期，重新读取
+	{
+		m_tailCache = m_tail.load(std::memory_order_acquire);
+		free = m_size - (head - m_tailCache);
+	}
+
+	len = (int)(free < contiguous ? free : contiguous);
+	return m_buf + pos;
+}
+
+void CSpscCycleBuffer::CommitWrite(int len)
+{
+	m_head.store(m_head.load(std::memory_order_relaxed) + len, std::memory_order_release);
+}
+
+int CSpscCycleBuffer::Write(const unsigned char *pdata, int len)
+{
+	if (!m_buf || len <= 0)
+		return 0;
+
+	unsigned int head = m_head.load(std::memory_order_relaxed);
+	if (m_size - (head - m_tailCache) < (unsigned int)len)
+		m_tailCache = m_tail.load(std::memory_order_acquire);
+
+	unsigned int free = m_size - (head - m_tailCache);
+	if ((unsigned int)len > free)
+		len = free;
+
+	unsigned int pos = head & m_mask;
+	unsigned int first = m_size - pos;
+	if (first > (unsigned int)len)
+		first = len;
+
+	memcpy(m_buf + pos, pdata, first);
+	memcpy(m_buf, pdata + first, len - first); // 折返部分
+	m_head.store(head + len, std::memory_order_release);
+	return len;
+}
+
+const unsigned char *CSpscCycleBuffer::PeekRead(int &len)
+{
+	unsigned int tail = m_tail.load(std::memory_order_relaxed);
+	unsigned int pos = tail & m_mask;
+	unsigned int contiguous = m_size - pos;
+	unsigned int avail = m_headCache - tail;
+	if (avail < contiguous) // 缓存的写位置可能已经过期，重新读取
+	{
+		m_headCache = m_head.load(std::memory_order_acquire);
+		avail = m_headCache - tail;
+	}
+
+	len = (int)(avail < contiguous ? avail : contiguous);
+	return m_buf + pos;
+}
+
+void CSpscCycleBuffer::CommitRead(int len)
+{
+	m_tail.store(m_tail.load(std::memory_order_relaxed) + len, std::memory_order_release);
+	NotifyFree();
+}
+
+int CSpscCycleBuffer::Read(unsigned char *pdata, int len)
+{
+	if (!m_buf || len <= 0)
+		return 0;
+
+	unsigned int tail = m_tail.load(std::memory_order_relaxed);
+	if (m_headCache - tail < (unsigned int)len)
+		m_headCache = m_head.load(std::memory_order_acquire);
+
+	unsigned int avail = m_headCache - tail;
+	if ((unsigned int)len > avail)
+		len = avail;
+
+	unsigned int pos = tail & m_mask;
+	unsigned int first = m_size - pos;
+	if (first > (unsigned int)len)
+		first = len;
+
+	memcpy(pdata, m_buf + pos, first);
+	memcpy(pdata + first, m_buf, len - first); // 折返部分
+	m_tail.store(tail + len, std::memory_order_release);
+	NotifyFree();
+	return len;
+}
+
+// 消费者：读位置前进之后，生产者在等待时唤醒它
+// 与WaitFree()各有一个全屏障：要么这里看到m_waiting，要么生产者看到新的读位置
+void CSpscCycleBuffer::NotifyFree()
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (!m_waiting.load(std::memory_order_relaxed))
+		return;
+
+	pthread_mutex_lock(&m_mutex);
+	pthread_cond_signal(&m_cond);
+	pthread_mutex_unlock(&m_mutex);
+}
+
+bool CSpscCycleBuffer::WaitFree(int len, const std::atomic<bool> &stop)
+{
+	if (GetFreeLength() >= len)
+		return true;
+
+	pthread_mutex_lock(&m_mutex);
+	m_waiting.store(true, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	while (GetFreeLength() < len && !stop.load(std::memory_order_acquire))
+		pthread_cond_wait(&m_cond, &m_mutex);
+	m_waiting.store(false, std::memory_order_relaxed);
+	pthread_mutex_unlock(&m_mutex);
+
+	return GetFreeLength() >= len;
+}
+
+void CSpscCycleBuffer::Wakeup()
+{
+	pthread_mutex_lock(&m_mutex);
+	pthread_cond_broadcast(&m_cond);
+	pthread_mutex_unlock(&m_mutex);
+}
+
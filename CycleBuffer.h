@@ -1,6 +1,9 @@
 #ifndef __CYCLE_BUFFER_H__
 #define __CYCLE_BUFFER_H__
 
+#include <atomic>
+#include <pthread.h>
+
 class CCycleBuffer
 {
 public:
@@ -23,5 +26,68 @@ protected:
 	int m_cur;
 };
 
+// 无锁的单生产者/单消费者环形缓冲区
+// 只允许一个线程写、一个线程读，读写两端不需要加锁。
+// 容量为2的幂，读写位置是一直递增的无符号数，取模用位与；
+// 读写位置分别放在不同的cache line上，避免两个线程互相踢cache。
+// 除Read/Write拷贝接口外，还提供PeekWrite/CommitWrite和PeekRead/CommitRead，
+// 直接在缓冲区内的连续区域上读写，省去一次拷贝。
+// 生产者可以用WaitFree()阻塞等待空闲空间：只有生产者在等待时，读端才加锁唤醒它
+#define SPSC_CACHE_LINE 64
+
+class CSpscCycleBuffer
+{
+public:
+	CSpscCycleBuffer(void);
+	~CSpscCycleBuffer(void);
+
+	// len向上取整到2的幂
+	bool Init(int len);
+	// 清空数据，须在没有其他线程读写时调用
+	void Clean();
+
+	int GetCapacity() {return (int)m_size;}
+	int GetLength();
+	int GetFreeLength();
+
+	// 生产者：拷贝写入，空间不够时只写入能写下的部分，返回写入的字节数
+	int Write(const unsigned char *pdata, int len);
+	// 生产者：返回可直接写入的连续区域，len返回区域大小(可能小于空闲空间，因为会在尾部折返)
+	unsigned char *PeekWrite(int &len);
+	// 生产者：提交写入的len字节
+	void CommitWrite(int len);
+
+	// 消费者：拷贝读出，返回读出的字节数
+	int Read(unsigned char *pdata, int len);
+	// 消费者：返回可直接读取的连续区域，len返回区域大小
+	const unsigned char *PeekRead(int &len);
+	// 消费者：释放已读取的len字节
+	void CommitRead(int len);
+
+	// 生产者：阻塞等待至少len字节的空闲空间，len不能超过容量
+	// stop为true或者被Wakeup()唤醒时不再等待，空间足够返回true
+	bool WaitFree(int len, const std::atomic<bool> &stop);
+	// 唤醒WaitFree()，须先把它的stop置为true
+	void Wakeup();
+
+private:
+	void NotifyFree();
+
+private:
+	unsigned char *m_buf;
+	unsigned int m_size;
+	unsigned int m_mask;
+
+	alignas(SPSC_CACHE_LINE) std::atomic<unsigned int> m_head; // 写位置，生产者修改
+	unsigned int m_tailCache; // 生产者看到的读位置，减少读取m_tail
+
+	alignas(SPSC_CACHE_LINE) std::atomic<unsigned int> m_tail; // 读位置，消费者修改
+	unsigned int m_headCache; // 消费者看到的写位置，减少读取m_head
+
+	std::atomic<bool> m_waiting; // 生产者正在WaitFree()中等待
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_cond; // 消费者释放空间时通知生产者
+};
+
 #endif
 
@@ -1,13 +1,16 @@
 #include "MediaAudioResampleEx.h"
 #include "samplerate.h"
 #include "print_log.h"
+#include "easy_mp3_stats.h"
 
 //////>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 // libsamplerate impl
 CResampleEx::CResampleEx()
 {
     state = NULL;
+    channels = 1;
     in_samples = out_samples = 8000;
+    in_frames = out_frames = 8000;
     frame_in = frame_out = NULL;
     in_extra = out_extra = 0;
     ratio = 1.0;
@@ -46,13 +49,17 @@ int CResampleEx::resample_create(
     ratio = rate_out * 1.0 / rate_in;
     LOG("ratio: %.2f\n", ratio);
 
-    /* Calculate number of samples for input and output */
-    in_samples = samples_per_frame; /* 160 samples  */
-    out_samples = rate_out / (rate_in / samples_per_frame);
+    /* Calculate number of samples for input and output,
+     * libsamplerate counts frames: one sample of every channel */
+    channels = channel_count > 0 ? channel_count : 1;
+    in_frames = samples_per_frame / channels; /* 160 samples  */
+    out_frames = rate_out / (rate_in / in_frames);
+    in_samples = in_frames * channels;
+    out_samples = out_frames * channels;
     LOG("in_samples: %d, out_samples: %d\n", in_samples, out_samples);
 
-    frame_in = (float *)calloc(in_samples + 8, sizeof(float));
-    frame_out = (float *)calloc(out_samples + 8, sizeof(float));
+    frame_in = (float *)calloc((in_frames + 8) * channels, sizeof(float));
+    frame_out = (float *)calloc((out_frames + 8) * channels, sizeof(float));
 
     /* Set the converter ratio */
     err = src_set_ratio((SRC_STATE *)state, ratio);
@@ -71,6 +78,7 @@ int CResampleEx::resample_create(
 
 void CResampleEx::resample_run(const short *input, short *output)
 {
+    EasyMp3StageScope stage(EASY_MP3_STAGE_RESAMPLE);
     SRC_DATA src_data;
 
     /* Check! */
@@ -82,35 +90,36 @@ void CResampleEx::resample_run(const short *input, short *output)
 
     if (in_extra)
     {
-        for (unsigned int i=0; i<in_extra; ++i)
-            frame_in[in_samples+i] = frame_in[in_samples-1];
+        for (unsigned int i=0; i<in_extra*channels; ++i)
+            frame_in[in_samples+i] = frame_in[in_samples-channels+i%channels];
     }
 
     /* Prepare SRC_DATA */
     memset(&src_data, 0, sizeof(src_data));
     src_data.data_in = frame_in;
     src_data.data_out = frame_out;
-    src_data.input_frames = in_samples + in_extra;
-    src_data.output_frames = out_samples + out_extra;
+    src_data.input_frames = in_frames + in_extra;
+    src_data.output_frames = out_frames + out_extra;
     src_data.src_ratio = ratio;
 
     /* Process! */
     src_process((SRC_STATE *)state, &src_data);
 
     /* Convert output back to short */
-    src_float_to_short_array(frame_out, output, src_data.output_frames_gen);
+    src_float_to_short_array(frame_out, output, src_data.output_frames_gen * channels);
 
     /* Replay last sample if conversion couldn't fill up the whole 
      * frame. This could happen for example with 22050 to 16000 conversion.
      */
-    if (src_data.output_frames_gen < (int)out_samples)
+    if (src_data.output_frames_gen < (int)out_frames)
     {
         if (in_extra < 4)
             in_extra++;
 
-        for (unsigned int i=src_data.output_frames_gen; i<out_samples; ++i)
+        unsigned int gen = src_data.output_frames_gen * channels;
+        for (unsigned int i=gen; i<out_samples; ++i)
         {
-            output[i] = output[src_data.output_frames_gen-1];
+            output[i] = gen >= channels ? output[i-channels] : 0;
         }
     }
 }
@@ -125,6 +134,16 @@ unsigned int CResampleEx::resample_get_output_size(void)
     return out_samples;
 }
 
+void CResampleEx::resample_reset(void)
+{
+    if (!state)
+        return;
+
+    src_reset((SRC_STATE *)state);
+    src_set_ratio((SRC_STATE *)state, ratio);
+    in_extra = out_extra = 0;
+}
+
 void CResampleEx::resample_destroy(void)
 {
     if (state)
@@ -2,6 +2,7 @@
 #define __AUDIO_RESAMPLE_EX_H__
 
 // 音频重采样：libsamplerate实现
+// 支持多声道交错数据，各声道独立重采样
 class CResampleEx
 {
 public:
@@ -9,6 +10,10 @@ public:
 	~CResampleEx();
 
 public:
+    /*
+     * channel_count：声道数，输入输出均为交错排列的数据
+     * samples_per_frame：每次resample_run()输入的采样点数，包含所有声道
+     */
     int resample_create(
         bool high_quality,
         bool large_filter,
@@ -17,14 +22,17 @@ public:
         unsigned int rate_out,
         unsigned int samples_per_frame);
     void resample_run(const short *input, short *output);
-    unsigned int resample_get_input_size(void);
-    unsigned int resample_get_output_size(void);
+    unsigned int resample_get_input_size(void); // 单位：采样点，包含所有声道
+    unsigned int resample_get_output_size(void); // 单位：采样点，包含所有声道
+    /* 清空历史数据，从头开始一段新的数据流 */
+    void resample_reset(void);
     void resample_destroy(void);
 
 private:
     void *state;
-    unsigned int in_samples;
-    unsigned int out_samples;
+    unsigned int channels;
+    unsigned int in_samples, in_frames;
+    unsigned int out_samples, out_frames;
     float *frame_in, *frame_out;
     unsigned in_extra, out_extra;
     double ratio;
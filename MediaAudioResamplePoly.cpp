@@ -0,0 +1,326 @@
+/*
+ * 音频重采样：内置多相FIR实现
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#include "MediaAudioResamplePoly.h"
+#include "print_log.h"
+#include "easy_mp3_stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RESAMPLE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+#define RESAMPLE_MAX_CHANNELS 8
+#define RESAMPLE_CHUNK_FRAMES 1024 // 每次最多放入buffer的输入帧数
+#define RESAMPLE_MAX_COEFS (512 * 1024) // 滤波器组最多的系数个数，超过时创建失败
+#define RESAMPLE_MAX_TAPS 1024 // 每组滤波器最多的阶数
+
+static unsigned int resampleGcd(unsigned int a, unsigned int b)
+{
+    while (b)
+    {
+        unsigned int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// 第一类零阶修正贝塞尔函数，用于Kaiser窗
+static double resampleBesselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 50; k++)
+    {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+// x与h的int16点积，taps是16的倍数
+static int resampleDotC(const short *x, const short *h, unsigned int taps)
+{
+    int sum = 0;
+    for (unsigned int i = 0; i < taps; i++)
+        sum += x[i] * h[i];
+    return sum;
+}
+
+#ifdef RESAMPLE_X86_SIMD
+__attribute__((target("sse2")))
+static int resampleDotSse2(const short *x, const short *h, unsigned int taps)
+{
+    __m128i acc = _mm_setzero_si128();
+    for (unsigned int i = 0; i < taps; i += 8)
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(x + i)),
+            _mm_loadu_si128((const __m128i *)(h + i))));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4e));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xb1));
+    return _mm_cvtsi128_si32(acc);
+}
+
+__attribute__((target("avx2")))
+static int resampleDotAvx2(const short *x, const short *h, unsigned int taps)
+{
+    __m256i acc = _mm256_setzero_si256();
+    for (unsigned int i = 0; i < taps; i += 16)
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *)(x + i)),
+            _mm256_loadu_si256((const __m256i *)(h + i))));
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    return _mm_cvtsi128_si32(sum);
+}
+#endif
+
+CResamplePoly::CResamplePoly()
+{
+    channels = 1;
+    up = down = 1;
+    taps = 16;
+    history = 0;
+    coefs = NULL;
+    next_phase = NULL;
+    phase_step = NULL;
+    for (int i = 0; i < RESAMPLE_MAX_CHANNELS; i++)
+        buffer[i] = NULL;
+    buf_len = buf_cap = 0;
+    pos = phase = 0;
+    dot = resampleDotC;
+}
+
+CResamplePoly::~CResamplePoly()
+{
+    resample_destroy();
+}
+
+int CResamplePoly::resample_create(ResampleQuality quality, unsigned int channel_count, unsigned int rate_in, unsigned int rate_out)
+{
+    static const struct
+    {
+        unsigned int taps; // 不降采样时的阶数
+        double cutoff; // 截止频率，相对于较低的奈奎斯特频率
+        double beta; // Kaiser窗参数，越大阻带衰减越大
+    } profiles[] = {
+        { 16, 0.85, 6.0 }, // RESAMPLE_QUALITY_FAST
+        { 32, 0.90, 8.0 }, // RESAMPLE_QUALITY_MEDIUM
+        { 64, 0.94, 9.5 }, // RESAMPLE_QUALITY_HIGH
+    };
+
+    resample_destroy();
+
+    if (channel_count == 0 || channel_count > RESAMPLE_MAX_CHANNELS || rate_in == 0 || rate_out == 0)
+        return -1;
+    if (quality < RESAMPLE_QUALITY_FAST || quality > RESAMPLE_QUALITY_HIGH)
+        quality = RESAMPLE_QUALITY_MEDIUM;
+
+    unsigned int g = resampleGcd(rate_in, rate_out);
+    channels = channel_count;
+    up = rate_out / g;
+    down = rate_in / g;
+
+    // 降采样时截止频率按比例降低，滤波器按比例加长，保持同样的过渡带陡峭程度
+    double scale = up < down ? (double)up / down : 1.0;
+    taps = (unsigned int)ceil(profiles[quality].taps / scale);
+    taps = (taps + 15) & ~15u;
+    if (taps > RESAMPLE_MAX_TAPS || (unsigned long)up * taps > RESAMPLE_MAX_COEFS)
+    {
+        LOGE("resample %u -> %u needs %u phases of %u taps, too large\n", rate_in, rate_out, up, taps);
+        return -1;
+    }
+
+    coefs = (short *)calloc(up * taps, sizeof(short));
+    next_phase = (unsigned int *)calloc(up, sizeof(unsigned int));
+    phase_step = (unsigned int *)calloc(up, sizeof(unsigned int));
+    if (!coefs || !next_phase || !phase_step)
+    {
+        resample_destroy();
+        return -1;
+    }
+
+    // 第p组滤波器对应的输出点位于 buffer[n + history] 之后 p/up 个采样点处
+    double fc = profiles[quality].cutoff * scale;
+    double beta = profiles[quality].beta;
+    double half = taps / 2.0;
+    history = taps / 2 - 1;
+    for (unsigned int p = 0; p < up; p++)
+    {
+        double h[RESAMPLE_MAX_TAPS];
+        double sum = 0;
+        for (unsigned int t = 0; t < taps; t++)
+        {
+            double d = (double)t - history - (double)p / up;
+            double x = fc * d;
+            double sinc = fabs(x) < 1e-9 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            double r = d / half;
+            double w = fabs(r) >= 1.0 ? 0 : resampleBesselI0(beta * sqrt(1.0 - r * r)) / resampleBesselI0(beta);
+            h[t] = fc * sinc * w;
+            sum += h[t];
+        }
+
+        // 归一化为Q15，并把舍入误差加到最大的系数上，保证直流增益正好为1
+        short *coef = coefs + p * taps;
+        int total = 0;
+        unsigned int peak = 0;
+        for (unsigned int t = 0; t < taps; t++)
+        {
+            coef[t] = (short)lrint(h[t] / sum * 32768);
+            total += coef[t];
+            if (abs(coef[t]) > abs(coef[peak]))
+                peak = t;
+        }
+        coef[peak] += 32768 - total;
+
+        next_phase[p] = (p + down) % up;
+        phase_step[p] = (p + down) / up;
+    }
+
+    buf_cap = taps + RESAMPLE_CHUNK_FRAMES;
+    for (unsigned int c = 0; c < channels; c++)
+    {
+        buffer[c] = (short *)calloc(buf_cap, sizeof(short));
+        if (!buffer[c])
+        {
+            resample_destroy();
+            return -1;
+        }
+    }
+
+    dot = resampleDotC;
+#ifdef RESAMPLE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        dot = resampleDotAvx2;
+    else if (__builtin_cpu_supports("sse2"))
+        dot = resampleDotSse2;
+#endif
+
+    resample_reset();
+    LOG("poly resample: %u -> %u (%u/%u), ch=%u, taps=%u, kernel=%s\n", rate_in, rate_out, up, down,
+        channels, taps, resample_get_kernel());
+    return 0;
+}
+
+void CResamplePoly::resample_reset(void)
+{
+    // 预留history个0，第一个输出点正好对齐第一个输入点
+    for (unsigned int c = 0; c < channels; c++)
+    {
+        if (buffer[c])
+            memset(buffer[c], 0, buf_cap * sizeof(short));
+    }
+    buf_len = history;
+    pos = 0;
+    phase = 0;
+}
+
+unsigned int CResamplePoly::resample_get_max_output(unsigned int in_frames)
+{
+    unsigned long frames = buf_len - pos + in_frames;
+    return (unsigned int)(frames * up / down + 2);
+}
+
+const char *CResamplePoly::resample_get_kernel(void)
+{
+#ifdef RESAMPLE_X86_SIMD
+    if (dot == resampleDotAvx2)
+        return "avx2";
+    if (dot == resampleDotSse2)
+        return "sse2";
+#endif
+    return "c";
+}
+
+void CResamplePoly::process_chunk(const short *input, unsigned int in_frames, short *output, unsigned int out_max, int &out_frames)
+{
+    // 拆分声道，追加到各自的buffer
+    for (unsigned int c = 0; c < channels; c++)
+    {
+        short *dst = buffer[c] + buf_len;
+        const short *src = input + c;
+        for (unsigned int i = 0; i < in_frames; i++, src += channels)
+            dst[i] = *src;
+    }
+    buf_len += in_frames;
+
+    while (pos + taps <= buf_len && (unsigned int)out_frames < out_max)
+    {
+        const short *h = coefs + phase * taps;
+        short *out = output + out_frames * channels;
+        for (unsigned int c = 0; c < channels; c++)
+        {
+            int v = (dot(buffer[c] + pos, h, taps) + (1 << 14)) >> 15;
+            out[c] = v > 32767 ? 32767 : (v < -32768 ? -32768 : v);
+        }
+        out_frames++;
+
+        pos += phase_step[phase];
+        phase = next_phase[phase];
+    }
+
+    // 丢弃以后不再用到的采样点，剩余不超过taps个
+    if (pos > 0)
+    {
+        unsigned int keep = pos < buf_len ? buf_len - pos : 0;
+        for (unsigned int c = 0; c < channels; c++)
+            memmove(buffer[c], buffer[c] + pos, keep * sizeof(short));
+        pos -= buf_len - keep;
+        buf_len = keep;
+    }
+}
+
+int CResamplePoly::resample_run(const short *input, unsigned int in_frames, short *output, unsigned int out_max)
+{
+    EasyMp3StageScope stage(EASY_MP3_STAGE_RESAMPLE);
+    int out_frames = 0;
+
+    if (!coefs || !input || !output)
+        return 0;
+
+    while (in_frames > 0)
+    {
+        unsigned int n = buf_cap - buf_len;
+        if (n > in_frames)
+            n = in_frames;
+        if (n == 0) // output已满，buffer没有消耗
+            break;
+
+        process_chunk(input, n, output, out_max, out_frames);
+        input += n * channels;
+        in_frames -= n;
+    }
+    return out_frames;
+}
+
+void CResamplePoly::resample_destroy(void)
+{
+    if (coefs)
+        free(coefs);
+    coefs = NULL;
+
+    if (next_phase)
+        free(next_phase);
+    next_phase = NULL;
+
+    if (phase_step)
+        free(phase_step);
+    phase_step = NULL;
+
+    for (int i = 0; i < RESAMPLE_MAX_CHANNELS; i++)
+    {
+        if (buffer[i])
+            free(buffer[i]);
+        buffer[i] = NULL;
+    }
+    buf_len = buf_cap = 0;
+}
+
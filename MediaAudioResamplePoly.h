@@ -0,0 +1,71 @@
+/*
+ * 音频重采样：内置多相FIR实现
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#ifndef __AUDIO_RESAMPLE_POLY_H__
+#define __AUDIO_RESAMPLE_POLY_H__
+
+// 重采样质量：滤波器越长，过渡带越窄、阻带衰减越大，速度越慢
+enum ResampleQuality
+{
+    RESAMPLE_QUALITY_FAST = 0, // 16阶，适合语音
+    RESAMPLE_QUALITY_MEDIUM, // 32阶
+    RESAMPLE_QUALITY_HIGH, // 64阶
+};
+
+// 有理数倍率的多相FIR重采样：
+// 输出/输入采样率约分为up/down(如48000->44100为147/160)，预先计算up组滤波器系数，
+// 每个输出点只需要一次长度为taps的int16点积，直接处理int16交错数据，无需转换成float
+class CResamplePoly
+{
+public:
+    CResamplePoly();
+    ~CResamplePoly();
+
+    /*
+     * 创建重采样器
+     * return：成功返回0，失败返回-1(如约分后的up太大，滤波器组占用内存过多)
+     */
+    int resample_create(ResampleQuality quality, unsigned int channel_count, unsigned int rate_in, unsigned int rate_out);
+
+    /*
+     * 重采样一段交错排列的数据，input可以是任意长度
+     * in_frames：输入帧数，一帧包含所有声道的一个采样点
+     * out_max：output能容纳的帧数，不小于resample_get_max_output(in_frames)时不会丢数据
+     * return：输出的帧数
+     */
+    int resample_run(const short *input, unsigned int in_frames, short *output, unsigned int out_max);
+
+    /* in_frames帧输入最多产生的输出帧数 */
+    unsigned int resample_get_max_output(unsigned int in_frames);
+
+    /* 清空历史数据，从头开始一段新的数据流 */
+    void resample_reset(void);
+    void resample_destroy(void);
+
+    /* 当前CPU上使用的点积实现 */
+    const char *resample_get_kernel(void);
+
+private:
+    void process_chunk(const short *input, unsigned int in_frames, short *output, unsigned int out_max, int &out_frames);
+
+private:
+    unsigned int channels;
+    unsigned int up, down; // 输出/输入采样率约分后的比值
+    unsigned int taps; // 每组滤波器的阶数，16的倍数
+    unsigned int history; // 对齐滤波器中心需要预留的历史采样点数
+    short *coefs; // up组滤波器系数，Q15
+    unsigned int *next_phase; // 每个相位输出之后的下一个相位
+    unsigned int *phase_step; // 每个相位输出之后输入前进的采样点数
+    short *buffer[8]; // 每个声道：taps-1个历史采样点 + 本次输入
+    unsigned int buf_len; // buffer中的有效采样点数(每个声道相同)
+    unsigned int buf_cap;
+    unsigned int pos; // 下一个输出点在buffer中的起始位置
+    unsigned int phase; // 下一个输出点的相位
+    int (*dot)(const short *x, const short *h, unsigned int taps);
+};
+
+#endif
+
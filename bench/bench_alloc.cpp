@@ -0,0 +1,140 @@
+/*
+ * 转换路径的堆内存分配测试：替换全局operator new/delete为计数版本，
+ * 转换器预热若干次之后，经EasyMp3FileSink/EasyMp3FrameArena输出时不应再分配内存
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#include "easy_mp3_convert.h"
+#include "easy_mp3_sink.h"
+#include "bench_mp3gen.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+
+#define BENCH_WARMUP 20 // 预热的convert()次数，之后开始计数
+#define BENCH_SECONDS 10 // 测试文件时长，单位s
+
+static long g_allocs = 0; // operator new的调用次数
+
+void *operator new(size_t size)
+{
+    g_allocs++;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    g_allocs++;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+static const struct
+{
+    int samplerate, channels, bitrate;
+    EasyMp3ResampleProfile profile;
+} benchOutputs[] = {
+    { 44100, 2, 128, EASY_MP3_RESAMPLE_SINC_BEST }, // 与测试文件格式相同，原样输出
+    { 16000, 1, 32, EASY_MP3_RESAMPLE_SINC_BEST },
+    { 22050, 2, 64, EASY_MP3_RESAMPLE_SINC_FASTEST },
+    { 32000, 1, 48, EASY_MP3_RESAMPLE_POLY_MEDIUM },
+};
+
+/*
+ * 转换整个文件，预热之后开始计数
+ * mode：0经EasyMp3FileSink写/dev/null，1经EasyMp3FrameArena逐帧取走，2用EasyMp3Converter0逐帧取出
+ * return：预热之后的分配次数，转换失败返回-1
+ */
+static long benchRun(const char *path, int k, int mode, int &calls)
+{
+    int rate = benchOutputs[k].samplerate;
+    int channels = benchOutputs[k].channels;
+    int bitrate = benchOutputs[k].bitrate;
+    long base = 0;
+    calls = 0;
+
+    if (mode == 2)
+    {
+        EasyMp3Converter0 converter(rate, channels, bitrate);
+        converter.setResampleProfile(benchOutputs[k].profile);
+        if (!converter.open(path))
+            return -1;
+
+        std::vector<unsigned char> frame; // 重复使用，容量足够之后不再分配
+        while (converter.convert(frame))
+        {
+            if (++calls == BENCH_WARMUP)
+                base = g_allocs;
+        }
+        return calls > BENCH_WARMUP ? g_allocs - base : -1;
+    }
+
+    EasyMp3Converter converter(path, rate, channels, bitrate);
+    converter.setResampleProfile(benchOutputs[k].profile);
+    EasyMp3FileSink file(64 * 1024);
+    EasyMp3FrameArena arena;
+    if (mode == 0 && !file.open("/dev/null"))
+        return -1;
+
+    EasyMp3Sink *sink = mode == 0 ? (EasyMp3Sink *)&file : (EasyMp3Sink *)&arena;
+    while (converter.convert(sink))
+    {
+        const unsigned char *data = NULL;
+        int size = 0;
+        while (arena.front(data, size))
+            arena.pop();
+
+        if (++calls == BENCH_WARMUP)
+            base = g_allocs;
+    }
+    long allocs = g_allocs - base;
+    file.close(); // 原样输出的帧指向文件映射区，须在转换器销毁之前输出
+    return calls > BENCH_WARMUP ? allocs : -1;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *modeNames[] = { "EasyMp3FileSink", "EasyMp3FrameArena", "EasyMp3Converter0" };
+    const char *path = argc > 1 ? argv[1] : "/tmp/bench_alloc.mp3";
+
+    run_init_log(RUN_LOG_ERR, 0);
+    if (!benchGenerateMp3(path, 44100, STEREO, 2, 128, BENCH_SECONDS)) // 44.1kHz立体声128kbps
+    {
+        fprintf(stderr, "generate %s failed\n", path);
+        run_log_exit();
+        return -1;
+    }
+
+    int failed = 0;
+    printf("%-22s %-18s %8s %8s\n", "output", "sink", "calls", "allocs");
+    for (size_t k = 0; k < sizeof(benchOutputs) / sizeof(benchOutputs[0]); k++)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "%d Hz %d ch %d kbps", benchOutputs[k].samplerate,
+            benchOutputs[k].channels, benchOutputs[k].bitrate);
+        for (int mode = 0; mode < 3; mode++)
+        {
+            int calls = 0;
+            long allocs = benchRun(path, k, mode, calls);
+            printf("%-22s %-18s %8d %8ld%s\n", name, modeNames[mode], calls, allocs, allocs != 0 ? "  FAILED" : "");
+            if (allocs != 0)
+                failed++;
+        }
+    }
+
+    remove(path);
+    printf("\n%s\n", failed ? "FAILED: steady-state convert allocates" : "no allocation in steady state");
+    run_log_exit();
+    return failed ? 1 : 0;
+}
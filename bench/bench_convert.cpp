@@ -0,0 +1,81 @@
+/*
+ * 转换性能测试：各重采样方式的整体吞吐量
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#include "easy_mp3_convert.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static const struct
+{
+    const char *name;
+    EasyMp3ResampleProfile profile;
+} benchProfiles[] = {
+    { "sinc-best", EASY_MP3_RESAMPLE_SINC_BEST },
+    { "sinc-medium", EASY_MP3_RESAMPLE_SINC_MEDIUM },
+    { "sinc-fastest", EASY_MP3_RESAMPLE_SINC_FASTEST },
+    { "linear", EASY_MP3_RESAMPLE_LINEAR },
+    { "poly-fast", EASY_MP3_RESAMPLE_POLY_FAST },
+    { "poly-medium", EASY_MP3_RESAMPLE_POLY_MEDIUM },
+    { "poly-high", EASY_MP3_RESAMPLE_POLY_HIGH },
+};
+
+// 单调时钟，单位ms
+static double benchNowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("usage: %s [-o rate channels bitrate] <mp3-file1> [<mp3-file2> ...]\n", argv[0]);
+        return -1;
+    }
+
+    int rate = 16000, channels = 1, bitrate = 32; // 默认语音类输出
+    int first = 1;
+    if (strcmp(argv[1], "-o") == 0 && argc > 5)
+    {
+        rate = atoi(argv[2]);
+        channels = atoi(argv[3]);
+        bitrate = atoi(argv[4]);
+        first = 5;
+    }
+
+    run_init_log(RUN_LOG_ERR, 0);
+    printf("output: %d Hz, %d ch, %d kbps\n", rate, channels, bitrate);
+
+    for (size_t k = 0; k < sizeof(benchProfiles) / sizeof(benchProfiles[0]); k++)
+    {
+        unsigned int mediaMs = 0;
+        size_t bytes = 0;
+        double start = benchNowMs();
+
+        for (int i = first; i < argc; i++)
+        {
+            EasyMp3Converter0 converter(rate, channels, bitrate);
+            std::vector<unsigned char> frame;
+
+            converter.setResampleProfile(benchProfiles[k].profile);
+            if (!converter.open(argv[i]))
+                continue;
+            while (converter.convert(frame))
+                bytes += frame.size();
+            mediaMs += converter.duration();
+        }
+
+        double cost = benchNowMs() - start;
+        printf("%-14s media %8u ms  cost %8.1f ms  rtf %8.1fx  output %zu bytes\n", benchProfiles[k].name,
+            mediaMs, cost, cost > 0 ? mediaMs / cost : 0, bytes);
+    }
+
+    run_log_exit();
+    return 0;
+}
@@ -0,0 +1,285 @@
+/*
+ * 编码性能测试：shine各SIMD级别的编码耗时和量化迭代(iteration loop)耗时，并检查输出是否一致；
+ * 两种码率控制方式(default/fast)的耗时和音质(解码后与原始信号的信噪比)对比
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#include "shine_mp3.h"
+#include "easy_mp3_stats.h"
+#include "easy_mp3_decoder.h"
+#include "print_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <vector>
+
+#define BENCH_SECONDS 20 // 每组测试的音频时长
+#define BENCH_MAX_DELAY 4096 // 查找编解码延迟的范围，单位采样点
+
+typedef struct
+{
+    int rate, channels, bitrate;
+    double noise; // 噪声幅度，越大量化后的值越大，ESC码表和查表范围外的情况越多
+}BenchCase;
+
+static const BenchCase benchCases[] = {
+    { 44100, 2, 128, 0.05 },
+    { 44100, 2, 320, 0.05 },
+    { 48000, 2, 192, 0.6 },
+    { 32000, 1, 64, 0.05 },
+    { 22050, 1, 48, 0.05 },
+    { 16000, 1, 32, 0.6 },
+};
+
+static const char *benchSimdNames[] = { "c", "sse4.1", "avx2" };
+static const char *benchRcNames[] = { "default", "fast" };
+
+// 单调时钟，单位ms
+static double benchNowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// 几个正弦信号加白噪声，各声道频率不同
+static void benchSignal(std::vector<short> &pcm, const BenchCase &bc, int seconds)
+{
+    unsigned int frames = bc.rate * seconds;
+    unsigned int seed = 12345;
+
+    pcm.resize(frames * bc.channels);
+    for (unsigned int i = 0; i < frames; i++)
+    {
+        for (int c = 0; c < bc.channels; c++)
+        {
+            double t = (double)i / bc.rate;
+            double v = 0.3 * sin(2 * M_PI * (220 + 110 * c) * t) + 0.15 * sin(2 * M_PI * 1870 * t)
+                + 0.05 * sin(2 * M_PI * (200 + 40 * t) * t * 30);
+            seed = seed * 1103515245 + 12345;
+            v += bc.noise * (((seed >> 8) & 0xffff) / 32768.0 - 1.0);
+            if (v > 1.0)
+                v = 1.0;
+            if (v < -1.0)
+                v = -1.0;
+            pcm[i * bc.channels + c] = (short)lrint(v * 32767);
+        }
+    }
+}
+
+// 解码全部MP3数据
+static void benchDecode(const std::vector<unsigned char> &mp3, std::vector<short> &pcm)
+{
+    void *decoder = EasyMp3DecoderCreate();
+    short frame[1152 * 2];
+    size_t pos = 0;
+
+    pcm.clear();
+    while (decoder && pos < mp3.size())
+    {
+        int mp3Bytes = (int)(mp3.size() - pos), pcmBytes = sizeof(frame);
+        if (EasyMp3DecoderDecode(decoder, &mp3[pos], mp3Bytes, (unsigned char *)frame, pcmBytes) != 0 || mp3Bytes <= 0)
+            break;
+        pos += mp3Bytes;
+        pcm.insert(pcm.end(), frame, frame + pcmBytes / sizeof(short));
+    }
+    EasyMp3DecoderDestroy(decoder);
+}
+
+// 解码数据相对原始信号的延迟(采样点)：取第一个声道上互相关最大的位置
+static int benchDelay(const std::vector<short> &ref, const std::vector<short> &decoded, int channels)
+{
+    size_t frames = ref.size() / channels;
+    size_t span = frames > 48000 ? 48000 : frames / 2;
+    int best = 0;
+    double bestCorr = -1e300;
+
+    for (int d = 0; d < BENCH_MAX_DELAY; d++)
+    {
+        if ((span + d) * channels > decoded.size())
+            break;
+        double corr = 0;
+        for (size_t i = 0; i < span; i++)
+            corr += (double)ref[i * channels] * decoded[(i + d) * channels];
+        if (corr > bestCorr)
+        {
+            bestCorr = corr;
+            best = d;
+        }
+    }
+    return best;
+}
+
+// 解码数据与原始信号的信噪比，单位dB
+static double benchSnr(const std::vector<short> &ref, const std::vector<short> &decoded, int channels, int delay)
+{
+    double sig = 0, noise = 0;
+    for (size_t i = 0; i < ref.size() && i + delay * channels < decoded.size(); i++)
+    {
+        double e = (double)decoded[i + delay * channels] - ref[i];
+        sig += (double)ref[i] * ref[i];
+        noise += e * e;
+    }
+    return noise > 0 ? 10 * log10(sig / noise) : 200;
+}
+
+// 编码全部数据，返回耗时(ms)，output为输出的MP3数据
+static double benchEncode(const BenchCase &bc, const std::vector<short> &pcm, shine_rate_control_t rc,
+    std::vector<unsigned char> &output, unsigned long long &iterationNs)
+{
+    shine_config_t config;
+    memset(&config, 0, sizeof(config));
+    shine_set_config_mpeg_defaults(&config.mpeg);
+    config.wave.channels = bc.channels == 1 ? PCM_MONO : PCM_STEREO;
+    config.wave.samplerate = bc.rate;
+    config.mpeg.bitr = bc.bitrate;
+    config.mpeg.mode = bc.channels == 1 ? MONO : STEREO;
+
+    output.clear();
+    shine_t shine = shine_initialise(&config);
+    if (!shine)
+        return -1;
+    shine_set_rate_control(shine, rc);
+
+    int samples = shine_samples_per_pass(shine);
+    size_t total = pcm.size() / bc.channels;
+    EasyMp3Stats before, after;
+    EasyMp3StatsGet(before);
+    double start = benchNowMs();
+
+    for (size_t pos = 0; pos + samples <= total; pos += samples)
+    {
+        int written = 0;
+        unsigned char *data = shine_encode_buffer_interleaved(shine, (int16_t *)&pcm[pos * bc.channels], &written);
+        output.insert(output.end(), data, data + written);
+    }
+    int written = 0;
+    unsigned char *data = shine_flush(shine, &written);
+    output.insert(output.end(), data, data + written);
+
+    double cost = benchNowMs() - start;
+    EasyMp3StatsGet(after);
+    iterationNs = after.ns[EASY_MP3_STAGE_ITERATION] - before.ns[EASY_MP3_STAGE_ITERATION];
+    shine_close(shine);
+    return cost;
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = BENCH_SECONDS, repeat = 3;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            seconds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [-t seconds] [-n repeat]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (seconds < 1)
+        seconds = BENCH_SECONDS;
+    if (repeat < 1)
+        repeat = 1;
+
+    run_init_log(RUN_LOG_ERR, 0);
+    EasyMp3StatsEnable(true);
+
+    int supported = shine_simd_supported();
+    int mismatches = 0;
+    printf("cpu supports: %s, %d s per case, best of %d\n", benchSimdNames[supported], seconds, repeat);
+    printf("%-18s %-7s %10s %12s %9s %6s\n", "case", "simd", "encode ms", "iteration ms", "speedup", "same");
+
+    for (size_t k = 0; k < sizeof(benchCases) / sizeof(benchCases[0]); k++)
+    {
+        const BenchCase &bc = benchCases[k];
+        std::vector<short> pcm;
+        std::vector<unsigned char> reference, output;
+        double iterationC = 0;
+        char name[32];
+
+        benchSignal(pcm, bc, seconds);
+        snprintf(name, sizeof(name), "%d/%d/%d%s", bc.rate, bc.channels, bc.bitrate, bc.noise > 0.5 ? " loud" : "");
+
+        for (int level = SHINE_SIMD_NONE; level <= supported; level++)
+        {
+            double best = -1, bestIteration = -1;
+            shine_set_simd((shine_simd_t)level);
+
+            for (int r = 0; r < repeat; r++)
+            {
+                unsigned long long iterationNs = 0;
+                double cost = benchEncode(bc, pcm, SHINE_RC_DEFAULT, output, iterationNs);
+                if (best < 0 || cost < best)
+                    best = cost;
+                if (bestIteration < 0 || iterationNs / 1e6 < bestIteration)
+                    bestIteration = iterationNs / 1e6;
+            }
+
+            if (level == SHINE_SIMD_NONE)
+            {
+                reference = output;
+                iterationC = bestIteration;
+            }
+            bool same = (output == reference);
+            if (!same)
+                mismatches++;
+
+            printf("%-18s %-7s %10.1f %12.1f %8.2fx %6s\n", name, benchSimdNames[level], best, bestIteration,
+                bestIteration > 0 ? iterationC / bestIteration : 0, same ? "yes" : "NO");
+        }
+    }
+
+    // 码率控制：在最高的SIMD级别下比较default和fast
+    shine_set_simd(shine_simd_supported());
+    printf("\n%-18s %-8s %10s %12s %9s %9s %9s\n", "case", "rc", "encode ms", "iteration ms", "speedup", "snr dB",
+        "delta dB");
+
+    for (size_t k = 0; k < sizeof(benchCases) / sizeof(benchCases[0]); k++)
+    {
+        const BenchCase &bc = benchCases[k];
+        std::vector<short> pcm, decoded;
+        std::vector<unsigned char> output;
+        double iterationDefault = 0, snrDefault = 0;
+        int delay = 0;
+        char name[32];
+
+        benchSignal(pcm, bc, seconds);
+        snprintf(name, sizeof(name), "%d/%d/%d%s", bc.rate, bc.channels, bc.bitrate, bc.noise > 0.5 ? " loud" : "");
+
+        for (int rc = SHINE_RC_DEFAULT; rc <= SHINE_RC_FAST; rc++)
+        {
+            double best = -1, bestIteration = -1;
+            for (int r = 0; r < repeat; r++)
+            {
+                unsigned long long iterationNs = 0;
+                double cost = benchEncode(bc, pcm, (shine_rate_control_t)rc, output, iterationNs);
+                if (best < 0 || cost < best)
+                    best = cost;
+                if (bestIteration < 0 || iterationNs / 1e6 < bestIteration)
+                    bestIteration = iterationNs / 1e6;
+            }
+
+            benchDecode(output, decoded);
+            if (rc == SHINE_RC_DEFAULT) // 两种方式的延迟相同
+                delay = benchDelay(pcm, decoded, bc.channels);
+            double snr = benchSnr(pcm, decoded, bc.channels, delay);
+            if (rc == SHINE_RC_DEFAULT)
+            {
+                iterationDefault = bestIteration;
+                snrDefault = snr;
+            }
+
+            printf("%-18s %-8s %10.1f %12.1f %8.2fx %9.2f %+9.2f\n", name, benchRcNames[rc], best, bestIteration,
+                bestIteration > 0 ? iterationDefault / bestIteration : 0, snr, snr - snrDefault);
+        }
+    }
+
+    run_log_exit();
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * 日志性能测试：编译期去掉、运行期过滤、限频、同步和异步输出的单次开销
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+// 本文件只编译INFO及以上的日志，LOGD在编译时去掉，用来和运行期过滤的LOG对比
+#define RUN_LOG_MIN_LEVEL RUN_LOG_INFO
+#include "print_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define BENCH_CALLS 1000000 // 每个线程的默认调用次数
+
+enum BenchMode
+{
+    BENCH_MODE_EMPTY = 0, // 空循环，作为基准
+    BENCH_MODE_COMPILED_OUT, // LOGD，编译时去掉
+    BENCH_MODE_FILTERED, // LOG，运行期级别为ERR，被过滤
+    BENCH_MODE_RATELIMIT, // LOG_RATELIMIT，每秒最多输出一次
+    BENCH_MODE_SYNC, // LOG，同步写文件
+    BENCH_MODE_ASYNC, // LOG，异步写文件
+    BENCH_MODE_NUM,
+};
+
+static const char *benchModeNames[BENCH_MODE_NUM] = {
+    "empty-loop", "compiled-out", "runtime-filtered", "ratelimit-1s", "sync-file", "async-file"
+};
+
+typedef struct
+{
+    int mode;
+    int calls;
+}BenchArg;
+
+// 单调时钟，单位ms
+static double benchNowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static volatile int g_benchSink = 0; // 防止空循环被优化掉
+
+// 模拟转换器每帧一条的日志
+static void *benchWorker(void *p)
+{
+    BenchArg *arg = (BenchArg *)p;
+    unsigned int bytes = 417;
+
+    for (int i = 0; i < arg->calls; i++)
+    {
+        g_benchSink = i;
+        switch (arg->mode)
+        {
+        case BENCH_MODE_COMPILED_OUT:
+            LOGD("frame: %d, %u bytes\n", i, bytes);
+            break;
+        case BENCH_MODE_RATELIMIT:
+            LOG_RATELIMIT(1000, "frame: %d, %u bytes\n", i, bytes);
+            break;
+        case BENCH_MODE_FILTERED:
+        case BENCH_MODE_SYNC:
+        case BENCH_MODE_ASYNC:
+            LOG("frame: %d, %u bytes\n", i, bytes);
+            break;
+        default:
+            break;
+        }
+    }
+    return NULL;
+}
+
+// 返回平均每次调用的耗时，单位ns
+static double benchRun(int mode, int threads, int calls)
+{
+    if (mode == BENCH_MODE_ASYNC)
+        run_init_log_async(RUN_LOG_INFO, 1);
+    else if (mode == BENCH_MODE_FILTERED)
+        run_init_log(RUN_LOG_ERR, 1);
+    else
+        run_init_log(RUN_LOG_INFO, 1);
+
+    pthread_t tid[64];
+    BenchArg arg = { mode, calls };
+    double start = benchNowMs();
+    for (int t = 0; t < threads; t++)
+        pthread_create(&tid[t], NULL, benchWorker, &arg);
+    for (int t = 0; t < threads; t++)
+        pthread_join(tid[t], NULL);
+    double cost = benchNowMs() - start; // 异步模式只计打印线程的耗时，不含后台写出
+
+    run_log_exit();
+    return cost * 1e6 / calls;
+}
+
+int main(int argc, char **argv)
+{
+    int threads = 1, calls = BENCH_CALLS;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+            calls = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [-t threads] [-c calls_per_thread]\n"
+                "log output goes to ./" RUN_LOG_FILE " and is removed afterwards\n", argv[0]);
+            return -1;
+        }
+    }
+    if (threads < 1)
+        threads = 1;
+    if (threads > 64)
+        threads = 64;
+    if (calls < 1)
+        calls = BENCH_CALLS;
+
+    printf("threads: %d, calls per thread: %d\n", threads, calls);
+    for (int mode = 0; mode < BENCH_MODE_NUM; mode++)
+    {
+        double ns = benchRun(mode, threads, calls);
+        printf("%-18s %10.1f ns/call  %10.2f Mcalls/s per thread\n", benchModeNames[mode], ns,
+            ns > 0 ? 1000.0 / ns : 0);
+    }
+
+    remove(RUN_LOG_FILE);
+    remove(RUN_LOG_FILE ".1");
+    return 0;
+}
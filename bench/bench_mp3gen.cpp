@@ -0,0 +1,66 @@
+/*
+ * 性能测试共用：用shine生成测试用的MP3文件
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#include "bench_mp3gen.h"
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+
+bool benchGenerateMp3(const std::string &path, int samplerate, enum modes mode, int channels, int bitrate,
+    int seconds)
+{
+    shine_config_t config;
+    shine_set_config_mpeg_defaults(&config.mpeg);
+    config.wave.samplerate = samplerate;
+    config.wave.channels = (enum channels)channels;
+    config.mpeg.mode = mode;
+    config.mpeg.bitr = bitrate;
+
+    shine_t shine = shine_initialise(&config);
+    if (!shine)
+        return false;
+
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (!fp)
+    {
+        shine_close(shine);
+        return false;
+    }
+
+    int spp = shine_samples_per_pass(shine);
+    long total = (long)samplerate * seconds;
+    double f0 = 100, f1 = samplerate * 0.45;
+    double phase = 0;
+    unsigned int seed = 1;
+    std::vector<short> pcm(spp * channels);
+    int written = 0;
+
+    for (long n = 0; n < total; n += spp)
+    {
+        for (int i = 0; i < spp; i++)
+        {
+            double t = (double)(n + i) / samplerate;
+            double f = f0 * pow(f1 / f0, t / seconds);
+            phase += 2 * M_PI * f / samplerate;
+            pcm[i * channels] = (short)(12000 * sin(phase));
+            if (channels == 2)
+            {
+                seed = seed * 1103515245 + 12345;
+                double noise = ((int)(seed >> 16 & 0x7fff) - 16384) / 16384.0;
+                double chord = sin(2 * M_PI * 220 * t) + sin(2 * M_PI * 277.2 * t) + sin(2 * M_PI * 329.6 * t);
+                pcm[i * 2 + 1] = (short)(5000 * chord + 800 * noise);
+            }
+        }
+        unsigned char *data = shine_encode_buffer_interleaved(shine, pcm.data(), &written);
+        fwrite(data, 1, written, fp);
+    }
+    unsigned char *data = shine_flush(shine, &written);
+    fwrite(data, 1, written, fp);
+
+    shine_close(shine);
+    fclose(fp);
+    return true;
+}
@@ -0,0 +1,23 @@
+/*
+ * 性能测试共用：用shine生成测试用的MP3文件
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#ifndef __BENCH_MP3GEN_H__
+#define __BENCH_MP3GEN_H__
+
+#include "shine_mp3.h"
+#include <string>
+
+/*
+ * 生成测试文件：左声道为对数扫频(100Hz到接近奈奎斯特频率)，右声道为和弦加少量噪声，
+ * 覆盖全频带，编码器和重采样器的负载接近真实音乐
+ * mode：shine的声道模式，channels为1时应为MONO
+ * bitrate：单位kbps
+ * return：成功返回true
+ */
+bool benchGenerateMp3(const std::string &path, int samplerate, enum modes mode, int channels, int bitrate,
+    int seconds);
+
+#endif
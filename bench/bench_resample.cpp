@@ -0,0 +1,154 @@
+/*
+ * 重采样性能测试：内置多相FIR与libsamplerate对比
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#include "MediaAudioResamplePoly.h"
+#include "MediaAudioResampleEx.h"
+#include "print_log.h"
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <vector>
+
+#define BENCH_SECONDS 30 // 每组测试的音频时长
+#define BENCH_TONE_HZ 1000.0 // 测试信号频率
+
+typedef struct
+{
+    unsigned int rateIn, rateOut, channels;
+}BenchCase;
+
+// 单调时钟，单位ms
+static double benchNowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// 生成各声道相同的正弦信号
+static void benchTone(std::vector<short> &pcm, unsigned int rate, unsigned int channels, unsigned int frames)
+{
+    pcm.resize(frames * channels);
+    for (unsigned int i = 0; i < frames; i++)
+    {
+        short v = (short)lrint(16384 * sin(2 * M_PI * BENCH_TONE_HZ * i / rate));
+        for (unsigned int c = 0; c < channels; c++)
+            pcm[i * channels + c] = v;
+    }
+}
+
+// 输出与理想正弦信号比较的信噪比(第一个声道)，跳过首尾的过渡部分
+static double benchSnr(const std::vector<short> &pcm, unsigned int rate, unsigned int channels)
+{
+    unsigned int frames = pcm.size() / channels;
+    unsigned int skip = rate / 10;
+    double sig = 0, noise = 0;
+    for (unsigned int i = skip; i + skip < frames; i++)
+    {
+        double ideal = 16384 * sin(2 * M_PI * BENCH_TONE_HZ * i / rate);
+        double e = pcm[i * channels] - ideal;
+        sig += ideal * ideal;
+        noise += e * e;
+    }
+    return noise > 0 ? 10 * log10(sig / noise) : 200;
+}
+
+static void benchReport(const char *name, const BenchCase &bc, double costMs, const std::vector<short> &out)
+{
+    double rtf = costMs > 0 ? BENCH_SECONDS * 1000.0 / costMs : 0;
+    printf("%-18s %6u -> %-6u ch=%u  cost %8.1f ms  rtf %8.1fx  snr %6.1f dB\n", name, bc.rateIn, bc.rateOut,
+        bc.channels, costMs, rtf, benchSnr(out, bc.rateOut, bc.channels));
+}
+
+// 内置多相FIR：与转换器一样按20ms一块输入
+static void benchPoly(const BenchCase &bc, ResampleQuality quality, const char *name, const std::vector<short> &in)
+{
+    CResamplePoly rs;
+    if (rs.resample_create(quality, bc.channels, bc.rateIn, bc.rateOut) != 0)
+    {
+        printf("%-18s %6u -> %-6u create failed\n", name, bc.rateIn, bc.rateOut);
+        return;
+    }
+
+    unsigned int block = bc.rateIn / 50;
+    unsigned int frames = in.size() / bc.channels;
+    std::vector<short> out((size_t)(frames + block) * bc.rateOut / bc.rateIn * bc.channels + 1024);
+    std::vector<short> tmp(rs.resample_get_max_output(block) * bc.channels);
+    size_t produced = 0;
+
+    double start = benchNowMs();
+    for (unsigned int i = 0; i + block <= frames; i += block)
+    {
+        int n = rs.resample_run(&in[i * bc.channels], block, tmp.data(), tmp.size() / bc.channels);
+        memcpy(&out[produced], tmp.data(), n * bc.channels * sizeof(short));
+        produced += n * bc.channels;
+    }
+    double cost = benchNowMs() - start;
+
+    out.resize(produced);
+    benchReport(name, bc, cost, out);
+}
+
+// libsamplerate：与转换器原来的用法相同，每块包含 rate/1000*20 帧
+static void benchSrc(const BenchCase &bc, bool highQuality, bool largeFilter, const char *name, const std::vector<short> &in)
+{
+    CResampleEx rs;
+    unsigned int spf = (bc.rateIn / 1000) * bc.channels * 20;
+    if (rs.resample_create(highQuality, largeFilter, bc.channels, bc.rateIn, bc.rateOut, spf) != 0)
+    {
+        printf("%-18s %6u -> %-6u create failed\n", name, bc.rateIn, bc.rateOut);
+        return;
+    }
+
+    unsigned int isize = rs.resample_get_input_size();
+    unsigned int osize = rs.resample_get_output_size();
+    std::vector<short> out((in.size() / isize + 1) * osize);
+    size_t produced = 0;
+
+    double start = benchNowMs();
+    for (size_t i = 0; i + isize <= in.size(); i += isize)
+    {
+        rs.resample_run(&in[i], &out[produced]);
+        produced += osize;
+    }
+    double cost = benchNowMs() - start;
+
+    out.resize(produced);
+    benchReport(name, bc, cost, out);
+}
+
+int main()
+{
+    static const BenchCase cases[] = {
+        { 48000, 44100, 2 },
+        { 44100, 48000, 2 },
+        { 44100, 16000, 1 },
+        { 48000, 22050, 1 },
+        { 16000, 44100, 2 },
+        { 8000, 16000, 1 },
+    };
+
+    run_init_log(RUN_LOG_ERR, 0);
+
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); k++)
+    {
+        const BenchCase &bc = cases[k];
+        std::vector<short> in;
+        benchTone(in, bc.rateIn, bc.channels, bc.rateIn * BENCH_SECONDS);
+
+        benchPoly(bc, RESAMPLE_QUALITY_FAST, "poly fast", in);
+        benchPoly(bc, RESAMPLE_QUALITY_MEDIUM, "poly medium", in);
+        benchPoly(bc, RESAMPLE_QUALITY_HIGH, "poly high", in);
+        benchSrc(bc, false, true, "src sinc fastest", in);
+        benchSrc(bc, true, false, "src sinc medium", in);
+        benchSrc(bc, true, true, "src sinc best", in);
+        printf("\n");
+    }
+
+    run_log_exit();
+    return 0;
+}
+
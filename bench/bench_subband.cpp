@@ -0,0 +1,136 @@
+/*
+ * 子带滤波内核测试：shine_window_filter_subband的C、SSE4.1、AVX2内核逐项比较，
+ * 输入为随机PCM和满幅(-32768/32767)的极端数据，同时给出每个内核的耗时
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#include "shine_mp3.cpp" // 各内核是shine_mp3.cpp中的static函数，直接包含源文件才能单独调用
+#include <time.h>
+
+#define BENCH_ROUNDS 200000 // 计时的调用次数
+
+typedef void (*BenchKernel)(const int32_t *x, int off, const int32_t fl[SBLIMIT][64], int32_t s[SBLIMIT]);
+
+static const char *benchSimdNames[] = { "c", "sse4.1", "avx2" };
+
+// 单调时钟，单位ms
+static double benchNowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static BenchKernel benchKernel(int level)
+{
+    switch (level)
+    {
+#ifdef SHINE_X86_SIMD
+    case SHINE_SIMD_AVX2:
+        return shine_window_filter_subband_avx2;
+    case SHINE_SIMD_SSE41:
+        return shine_window_filter_subband_sse41;
+#endif
+    default:
+        return shine_window_filter_subband_c;
+    }
+}
+
+static unsigned int g_seed = 12345;
+
+static short benchRandom(void)
+{
+    g_seed = g_seed * 1103515245 + 12345;
+    return (short)(g_seed >> 16);
+}
+
+/*
+ * 按测试方式生成滤波器窗口中的全部采样点，与shine_window_filter_subband()一样左移16位
+ * mode：0随机，1全为-32768，2全为32767，3正负满幅交替，4随机取正负满幅
+ */
+static void benchFill(int32_t x[HAN_SIZE], int mode)
+{
+    for (int i = 0; i < HAN_SIZE; i++)
+    {
+        int v = 0;
+        switch (mode)
+        {
+        case 0: v = benchRandom(); break;
+        case 1: v = -32768; break;
+        case 2: v = 32767; break;
+        case 3: v = (i & 1) ? 32767 : -32768; break;
+        default: v = (benchRandom() & 1) ? 32767 : -32768; break;
+        }
+        x[i] = ((int32_t)v) << 16;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static const char *modeNames[] = { "random", "all -32768", "all 32767", "alternate", "random full-scale" };
+    const int modes = sizeof(modeNames) / sizeof(modeNames[0]);
+    int rounds = 64; // 每种输入的随机轮数
+    if (argc > 1)
+        rounds = atoi(argv[1]);
+    if (rounds < 1)
+        rounds = 1;
+
+    const int32_t (*fl)[64] = shine_get_tables()->fl;
+    int supported = shine_simd_supported();
+    int mismatches = 0;
+    int32_t x[HAN_SIZE];
+    int32_t ref[SBLIMIT], out[SBLIMIT];
+
+    printf("cpu supports: %s, %d rounds per input\n", benchSimdNames[supported], rounds);
+    for (int mode = 0; mode < modes; mode++)
+    {
+        int bad[3] = { 0, 0, 0 };
+        for (int r = 0; r < rounds; r++)
+        {
+            benchFill(x, mode);
+            for (int off = 0; off < HAN_SIZE; off += 32) // 编码时off总是32的倍数
+            {
+                shine_window_filter_subband_c(x, off, fl, ref);
+                for (int level = SHINE_SIMD_SSE41; level <= supported; level++)
+                {
+                    benchKernel(level)(x, off, fl, out);
+                    if (memcmp(ref, out, sizeof(ref)) != 0)
+                        bad[level]++;
+                }
+            }
+        }
+
+        printf("%-18s", modeNames[mode]);
+        for (int level = SHINE_SIMD_SSE41; level <= supported; level++)
+        {
+            printf(" %s %s", benchSimdNames[level], bad[level] ? "MISMATCH" : "ok");
+            mismatches += bad[level];
+        }
+        printf("\n");
+    }
+
+    // 耗时：随机输入，按编码时的方式轮转off
+    benchFill(x, 0);
+    printf("\n%-8s %12s %9s\n", "kernel", "ns per call", "speedup");
+    double costC = 0;
+    for (int level = SHINE_SIMD_NONE; level <= supported; level++)
+    {
+        BenchKernel kernel = benchKernel(level);
+        int off = 0;
+        double start = benchNowMs();
+        for (int n = 0; n < BENCH_ROUNDS; n++)
+        {
+            kernel(x, off, fl, out);
+            off = (off + 480) & (HAN_SIZE - 1);
+            x[n & (HAN_SIZE - 1)] ^= out[n & (SBLIMIT - 1)] & 0xffff0000; // 让每次的输入都不同，结果不会被优化掉
+        }
+        double ns = (benchNowMs() - start) * 1e6 / BENCH_ROUNDS;
+        if (level == SHINE_SIMD_NONE)
+            costC = ns;
+        printf("%-8s %12.1f %8.2fx\n", benchSimdNames[level], ns, ns > 0 ? costC / ns : 0);
+    }
+
+    printf("\n%s\n", mismatches ? "FAILED: SIMD output differs from C" : "all kernels match the C code");
+    return mismatches ? 1 : 0;
+}
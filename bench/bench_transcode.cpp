@@ -0,0 +1,344 @@
+/*
+ * 重编码性能测试：全部MPEG-1/2/2.5采样率和声道模式，分阶段耗时，输出JSON
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#include "easy_mp3_convert.h"
+#include "easy_mp3_stats.h"
+#include "bench_mp3gen.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+// 测试输入：采样率 × 声道模式，比特率按MPEG版本取常用值
+typedef struct
+{
+    const char *version;
+    int samplerate;
+    int bitrate;
+}BenchRate;
+
+typedef struct
+{
+    const char *name;
+    enum modes mode;
+    int channels;
+}BenchMode;
+
+static const BenchRate benchRates[] = {
+    { "1", 48000, 128 }, { "1", 44100, 128 }, { "1", 32000, 128 },
+    { "2", 24000, 64 }, { "2", 22050, 64 }, { "2", 16000, 64 },
+    { "2.5", 12000, 32 }, { "2.5", 11025, 32 }, { "2.5", 8000, 32 },
+};
+
+static const BenchMode benchModes[] = {
+    { "stereo", STEREO, 2 },
+    { "joint_stereo", JOINT_STEREO, 2 },
+    { "dual_channel", DUAL_CHANNEL, 2 },
+    { "mono", MONO, 1 },
+};
+
+static const struct
+{
+    const char *name;
+    EasyMp3ResampleProfile profile;
+} benchProfiles[] = {
+    { "sinc-best", EASY_MP3_RESAMPLE_SINC_BEST },
+    { "sinc-medium", EASY_MP3_RESAMPLE_SINC_MEDIUM },
+    { "sinc-fastest", EASY_MP3_RESAMPLE_SINC_FASTEST },
+    { "linear", EASY_MP3_RESAMPLE_LINEAR },
+    { "poly-fast", EASY_MP3_RESAMPLE_POLY_FAST },
+    { "poly-medium", EASY_MP3_RESAMPLE_POLY_MEDIUM },
+    { "poly-high", EASY_MP3_RESAMPLE_POLY_HIGH },
+};
+
+// 分阶段耗时取自转换器自己的统计(easy_mp3_stats)，other为整体耗时减去各阶段之和，即写出和其余开销
+#define STAGE_OTHER EASY_MP3_STAGE_NUM
+#define STAGE_NUM (EASY_MP3_STAGE_NUM + 1)
+
+typedef struct
+{
+    int rate, channels, bitrate; // 输出格式
+    EasyMp3ResampleProfile profile;
+    int profileIndex;
+    int seconds; // 每个输入的音频时长
+    int repeat; // 整体转换重复次数，取最快的一次
+}BenchConfig;
+
+typedef struct
+{
+    std::string name;
+    const BenchRate *rate;
+    const BenchMode *mode;
+    int inFrames;
+    unsigned int mediaMs;
+    bool passthrough;
+    double convertMs; // EasyMp3Converter整体耗时
+    int outFrames;
+    long outBytes;
+    double stageMs[STAGE_NUM]; // 最快一次转换的各阶段耗时，iteration包含在encode之内
+}BenchResult;
+
+// 单调时钟，单位ms
+static double benchNowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// 统计输出帧数再转交给文件：顺序模式下转换器每次write()正好是一帧
+class BenchCountSink : public EasyMp3Sink
+{
+public:
+    BenchCountSink(EasyMp3Sink *next) : m_next(next), m_frames(0) {}
+
+    bool write(const unsigned char *data, int size)
+    {
+        m_frames++;
+        m_bytes += size;
+        return m_next->write(data, size);
+    }
+
+    bool writeStable(const unsigned char *data, int size)
+    {
+        m_frames++;
+        m_bytes += size;
+        return m_next->writeStable(data, size);
+    }
+
+    int frames() { return m_frames; }
+
+private:
+    EasyMp3Sink *m_next;
+    int m_frames;
+};
+
+static const char *benchStageName(int stage)
+{
+    return stage == STAGE_OTHER ? "other" : EasyMp3StageName(stage);
+}
+
+/* 输入文件的帧数，不计时 */
+static int benchCountFrames(const std::string &path)
+{
+    Mp3FileParse parser(path);
+    const unsigned char *frame = NULL;
+    int size = 0, frames = 0;
+    while (parser.GetNextFrame(frame, size))
+        frames++;
+    return frames;
+}
+
+/*
+ * EasyMp3Converter整体转换，写到/dev/null，重复cfg.repeat次取最快的一次
+ * 各阶段耗时为转换前后EasyMp3StatsGet()的差值
+ */
+static bool benchConvert(const BenchConfig &cfg, const std::string &path, BenchResult &res)
+{
+    res.convertMs = -1;
+    res.inFrames = benchCountFrames(path);
+    for (int r = 0; r < cfg.repeat; r++)
+    {
+        EasyMp3FileSink file(512 * 1024);
+        BenchCountSink sink(&file);
+        if (!file.open("/dev/null"))
+            return false;
+
+        EasyMp3Stats before, after;
+        EasyMp3StatsGet(before);
+        double start = benchNowMs();
+        EasyMp3Converter converter(path, cfg.rate, cfg.channels, cfg.bitrate);
+        converter.setResampleProfile(cfg.profile);
+        while (converter.convert(&sink))
+            ;
+        file.close();
+        double cost = benchNowMs() - start;
+        EasyMp3StatsGet(after);
+
+        if (res.convertMs < 0 || cost < res.convertMs)
+        {
+            res.convertMs = cost;
+            res.stageMs[STAGE_OTHER] = cost;
+            for (int s = 0; s < EASY_MP3_STAGE_NUM; s++)
+            {
+                res.stageMs[s] = (after.ns[s] - before.ns[s]) / 1e6;
+                if (s != EASY_MP3_STAGE_ITERATION)
+                    res.stageMs[STAGE_OTHER] -= res.stageMs[s];
+            }
+        }
+        res.mediaMs = converter.duration();
+        res.passthrough = converter.passthrough();
+        res.outFrames = sink.frames();
+        res.outBytes = sink.bytes();
+    }
+    return res.convertMs >= 0;
+}
+
+static double benchRtf(unsigned int mediaMs, double costMs)
+{
+    return costMs > 0 ? mediaMs / costMs : 0;
+}
+
+static void benchPrintJson(FILE *fp, const BenchConfig &cfg, const std::vector<BenchResult> &results)
+{
+    unsigned int mediaMs = 0;
+    double convertMs = 0, stageTotal[STAGE_NUM] = { 0 };
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"benchmark\": \"bench_transcode\",\n");
+    fprintf(fp, "  \"output\": { \"samplerate\": %d, \"channels\": %d, \"bitrate\": %d, \"resample\": \"%s\" },\n",
+        cfg.rate, cfg.channels, cfg.bitrate, benchProfiles[cfg.profileIndex].name);
+    fprintf(fp, "  \"seconds\": %d,\n  \"repeat\": %d,\n", cfg.seconds, cfg.repeat);
+    fprintf(fp, "  \"cases\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult &r = results[i];
+        for (int s = 0; s < STAGE_NUM; s++)
+            stageTotal[s] += r.stageMs[s];
+        mediaMs += r.mediaMs;
+        convertMs += r.convertMs;
+
+        fprintf(fp, "    {\n");
+        fprintf(fp, "      \"name\": \"%s\",\n", r.name.c_str());
+        fprintf(fp, "      \"input\": { \"mpeg\": \"%s\", \"samplerate\": %d, \"mode\": \"%s\", \"channels\": %d, "
+            "\"bitrate\": %d, \"frames\": %d, \"media_ms\": %u },\n", r.rate->version, r.rate->samplerate,
+            r.mode->name, r.mode->channels, r.rate->bitrate, r.inFrames, r.mediaMs);
+        fprintf(fp, "      \"convert\": { \"passthrough\": %s, \"cost_ms\": %.3f, \"frames_out\": %d, \"bytes_out\": %ld, "
+            "\"fps\": %.1f, \"rtf\": %.2f },\n", r.passthrough ? "true" : "false", r.convertMs, r.outFrames,
+            r.outBytes, r.convertMs > 0 ? r.inFrames * 1000.0 / r.convertMs : 0, benchRtf(r.mediaMs, r.convertMs));
+        fprintf(fp, "      \"stages_ms\": {");
+        for (int s = 0; s < STAGE_NUM; s++)
+            fprintf(fp, " \"%s\": %.3f,", benchStageName(s), r.stageMs[s]);
+        fprintf(fp, " \"total\": %.3f }\n", r.convertMs);
+        fprintf(fp, "    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(fp, "  ],\n");
+
+    fprintf(fp, "  \"summary\": { \"media_ms\": %u, \"cost_ms\": %.3f, \"rtf\": %.2f, \"stages_ms\": {",
+        mediaMs, convertMs, benchRtf(mediaMs, convertMs));
+    for (int s = 0; s < STAGE_NUM; s++)
+        fprintf(fp, " \"%s\": %.3f%s", benchStageName(s), stageTotal[s], s + 1 < STAGE_NUM ? "," : "");
+    fprintf(fp, " } }\n}\n");
+}
+
+int main(int argc, char **argv)
+{
+    BenchConfig cfg;
+    cfg.rate = 44100;
+    cfg.channels = 2;
+    cfg.bitrate = 128;
+    cfg.profile = EASY_MP3_RESAMPLE_SINC_BEST;
+    cfg.profileIndex = 0;
+    cfg.seconds = 10;
+    cfg.repeat = 3;
+    const char *dir = ".";
+    const char *jsonFile = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i + 3 < argc)
+        {
+            cfg.rate = atoi(argv[i + 1]);
+            cfg.channels = atoi(argv[i + 2]);
+            cfg.bitrate = atoi(argv[i + 3]);
+            i += 3;
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            size_t k = 0;
+            for (; k < sizeof(benchProfiles) / sizeof(benchProfiles[0]); k++)
+            {
+                if (strcmp(argv[i + 1], benchProfiles[k].name) == 0)
+                    break;
+            }
+            if (k == sizeof(benchProfiles) / sizeof(benchProfiles[0]))
+            {
+                fprintf(stderr, "unknown resample profile: %s\n", argv[i + 1]);
+                return -1;
+            }
+            cfg.profile = benchProfiles[k].profile;
+            cfg.profileIndex = (int)k;
+            i++;
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            cfg.seconds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            cfg.repeat = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+            dir = argv[++i];
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            jsonFile = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [-o rate channels bitrate] [-r profile] [-t seconds] [-n repeat] "
+                "[-d input_dir] [-j json_file]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (cfg.seconds <= 0)
+        cfg.seconds = 1;
+    if (cfg.repeat <= 0)
+        cfg.repeat = 1;
+
+    run_init_log(RUN_LOG_ERR, 0);
+    EasyMp3StatsEnable(true);
+    fprintf(stderr, "output: %d Hz, %d ch, %d kbps, resample %s, %d s per input\n", cfg.rate, cfg.channels,
+        cfg.bitrate, benchProfiles[cfg.profileIndex].name, cfg.seconds);
+    fprintf(stderr, "%-22s %6s %9s %8s %9s |", "input", "frames", "cost_ms", "fps", "rtf");
+    for (int s = 0; s < STAGE_NUM; s++)
+        fprintf(stderr, " %9s", benchStageName(s));
+    fprintf(stderr, "\n");
+
+    std::vector<BenchResult> results;
+    for (size_t i = 0; i < sizeof(benchRates) / sizeof(benchRates[0]); i++)
+    {
+        for (size_t m = 0; m < sizeof(benchModes) / sizeof(benchModes[0]); m++)
+        {
+            BenchResult res;
+            char name[64];
+            snprintf(name, sizeof(name), "mpeg%s_%d_%s", benchRates[i].version, benchRates[i].samplerate,
+                benchModes[m].name);
+            res.name = name;
+            res.rate = &benchRates[i];
+            res.mode = &benchModes[m];
+
+            std::string path = std::string(dir) + "/bench_" + name + ".mp3";
+            if (!benchGenerateMp3(path, benchRates[i].samplerate, benchModes[m].mode, benchModes[m].channels,
+                benchRates[i].bitrate, cfg.seconds))
+            {
+                fprintf(stderr, "%-22s generate failed\n", name);
+                continue;
+            }
+            if (!benchConvert(cfg, path, res))
+            {
+                fprintf(stderr, "%-22s convert failed\n", name);
+                continue;
+            }
+
+            fprintf(stderr, "%-22s %6d %9.1f %8.0f %8.1fx |", name, res.inFrames, res.convertMs,
+                res.convertMs > 0 ? res.inFrames * 1000.0 / res.convertMs : 0, benchRtf(res.mediaMs, res.convertMs));
+            for (int s = 0; s < STAGE_NUM; s++)
+                fprintf(stderr, " %9.1f", res.stageMs[s]);
+            fprintf(stderr, "\n");
+            results.push_back(res);
+            remove(path.c_str());
+        }
+    }
+
+    FILE *fp = jsonFile ? fopen(jsonFile, "w") : stdout;
+    if (!fp)
+    {
+        fprintf(stderr, "can not open %s\n", jsonFile);
+        return -1;
+    }
+    benchPrintJson(fp, cfg, results);
+    if (fp != stdout)
+        fclose(fp);
+
+    run_log_exit();
+    return 0;
+}
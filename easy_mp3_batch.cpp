@@ -0,0 +1,213 @@
+/*
+ * MP3批量重编码
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#include "easy_mp3_batch.h"
+#include "easy_mp3_convert.h"
+#include "easy_mp3_frame_index.h"
+#include "print_log.h"
+#include <time.h>
+#include <unistd.h>
+
+// data中的MP3帧数，ms返回这些帧的总时长
+static unsigned int batchCountFrames(const std::vector<unsigned char> &data, unsigned int &ms)
+{
+    MpegAudioFrameInfo info;
+    long pos = 0, framePos = 0;
+    unsigned int frames = 0;
+    double total = 0; // 累计时长，单位ms
+    bool firstFrame = true;
+
+    while (findNextMpegAudioFrame(data.data(), data.size(), pos, firstFrame, framePos, &info))
+    {
+        bool tagFrame = firstFrame && info.bitrateType; // 原样输出的XING/INFO/VBRI帧不含音频数据
+        firstFrame = false;
+        if (tagFrame)
+            continue;
+        frames++;
+        total += info.samplesPerFrame * 1000.0 / info.samplerate;
+    }
+    ms = (unsigned int)total;
+    return frames;
+}
+
+// 单调时钟，单位ms
+static double batchNowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+EasyMp3BatchConverter::EasyMp3BatchConverter(int destSampleRate, int destChannel, int destBitRate, int threads)
+{
+    m_destRate = destSampleRate;
+    m_destChannel = destChannel;
+    m_destBitRate = destBitRate;
+
+    if (threads <= 0)
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads <= 0)
+        threads = 1;
+    m_threads = threads;
+    m_pipelined = false;
+    m_encodeThreads = 1;
+    m_resampleProfile = EASY_MP3_RESAMPLE_SINC_BEST;
+    m_encodeProfile = EASY_MP3_ENCODE_DEFAULT;
+
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond, NULL);
+
+    m_files = NULL;
+    m_nextJob = 0;
+    m_nextOutput = 0;
+    m_window = m_threads * 2;
+    m_totalMediaMs = 0;
+    m_totalCostMs = 0;
+}
+
+EasyMp3BatchConverter::~EasyMp3BatchConverter()
+{
+    pthread_cond_destroy(&m_cond);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+/*
+ * 转换一个文件，整个文件的数据保存在result.data中
+ * converter：本线程的转换器，各文件依次复用
+ */
+void EasyMp3BatchConverter::convertFile(EasyMp3Converter0 &converter, EasyMp3BatchResult &result)
+{
+    EasyMp3MemorySink sink(result.data); // 编码器输出直接追加到result.data
+    double start = batchNowMs();
+
+    converter.setPipelined(m_pipelined);
+    converter.setParallelEncode(m_encodeThreads);
+    converter.setResampleProfile(m_resampleProfile);
+    converter.setEncodeProfile(m_encodeProfile);
+    result.ok = converter.open(result.fileName);
+    while (converter.convert(&sink))
+        ;
+    // 时长按输出的帧计算，不再为了取时长扫描一遍源文件
+    result.frames = batchCountFrames(result.data, result.mediaMs);
+
+    result.costMs = batchNowMs() - start;
+    result.rtf = result.costMs > 0 ? result.mediaMs / result.costMs : 0;
+}
+
+void *EasyMp3BatchConverter::workerThread(void *arg)
+{
+    ((EasyMp3BatchConverter *)arg)->worker();
+    return NULL;
+}
+
+/* 工作线程：领取任务 -> 转换 -> 提交结果 */
+void EasyMp3BatchConverter::worker()
+{
+    int total = (int)m_files->size();
+    EasyMp3Converter0 converter(m_destRate, m_destChannel, m_destBitRate); // 本线程转换的文件共用
+
+    pthread_mutex_lock(&m_mutex);
+    while (true)
+    {
+        // 领先输出太多时等待，避免缓存过多转换结果
+        while (m_nextJob < total && m_nextJob - m_nextOutput >= m_window)
+            pthread_cond_wait(&m_cond, &m_mutex);
+
+        if (m_nextJob >= total)
+            break;
+
+        int index = m_nextJob++;
+        pthread_mutex_unlock(&m_mutex);
+
+        EasyMp3BatchResult *result = new EasyMp3BatchResult();
+        result->fileName = (*m_files)[index];
+        result->ok = false;
+        result->frames = 0;
+        result->mediaMs = 0;
+        result->costMs = 0;
+        result->rtf = 0;
+        convertFile(converter, *result);
+
+        pthread_mutex_lock(&m_mutex);
+        m_results[index] = result;
+        pthread_cond_broadcast(&m_cond);
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+/*
+ * 并行转换files，阻塞到全部完成
+ * return：成功转换的文件数
+ */
+int EasyMp3BatchConverter::run(const std::vector<std::string> &files, EasyMp3BatchCallback callback, void *arg)
+{
+    int total = (int)files.size();
+    int succeed = 0;
+    double start = batchNowMs();
+
+    m_files = &files;
+    m_results.assign(total, (EasyMp3BatchResult *)NULL);
+    m_nextJob = 0;
+    m_nextOutput = 0;
+    m_window = m_threads * 2;
+    m_totalMediaMs = 0;
+    m_totalCostMs = 0;
+
+    int count = m_threads < total ? m_threads : total;
+    std::vector<pthread_t> tids;
+    for (int i = 0; i < count; i++)
+    {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, workerThread, this) == 0)
+            tids.push_back(tid);
+    }
+
+    if (tids.empty() && total > 0) // 创建线程失败，在当前线程中完成
+    {
+        LOGE("can not create worker thread, run in caller thread\n");
+        m_window = total; // 没有输出线程并行，不能限制领先数量
+        worker();
+    }
+
+    // 按输入顺序输出
+    pthread_mutex_lock(&m_mutex);
+    while (m_nextOutput < total)
+    {
+        while (!m_results[m_nextOutput])
+            pthread_cond_wait(&m_cond, &m_mutex);
+
+        EasyMp3BatchResult *result = m_results[m_nextOutput];
+        m_results[m_nextOutput] = NULL;
+        pthread_mutex_unlock(&m_mutex);
+
+        LOG("[%d/%d] %s: %u frames, media %u ms, cost %.1f ms, rtf %.1fx\n", m_nextOutput + 1, total,
+            result->fileName.c_str(), result->frames, result->mediaMs, result->costMs, result->rtf);
+
+        if (result->ok)
+            succeed++;
+        m_totalMediaMs += result->mediaMs;
+
+        if (callback)
+            callback(m_nextOutput, *result, arg);
+        delete result;
+
+        pthread_mutex_lock(&m_mutex);
+        m_nextOutput++;
+        pthread_cond_broadcast(&m_cond);
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    for (size_t i = 0; i < tids.size(); i++)
+        pthread_join(tids[i], NULL);
+
+    m_totalCostMs = batchNowMs() - start;
+    m_files = NULL;
+
+    LOG("batch done: %d/%d files, %d threads, media %u ms, cost %.1f ms, rtf %.1fx\n", succeed, total,
+        count, m_totalMediaMs, m_totalCostMs, realtimeFactor());
+    return succeed;
+}
+
@@ -0,0 +1,98 @@
+/*
+ * MP3批量重编码
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#ifndef __EASY_MP3_BATCH_H__
+#define __EASY_MP3_BATCH_H__
+
+#include "easy_mp3_convert.h"
+#include <pthread.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+// 单个文件的重编码结果
+typedef struct EasyMp3BatchResult
+{
+    std::string fileName; // 源文件
+    bool ok; // 是否转换出了数据
+    std::vector<unsigned char> data; // 重编码后的MP3数据
+    unsigned int frames; // 重编码后的帧数
+    unsigned int mediaMs; // 音频时长，单位ms，按重编码后的帧计算
+    double costMs; // 转换耗时，单位ms
+    double rtf; // 实时倍率：mediaMs/costMs，越大越快
+}EasyMp3BatchResult;
+
+/*
+ * 结果输出回调，在调用run()的线程中按输入顺序依次调用
+ * index：文件在输入列表中的序号
+ */
+typedef void (*EasyMp3BatchCallback)(int index, const EasyMp3BatchResult &result, void *arg);
+
+// 固定大小的线程池，每个线程独立运行一条EasyMp3Converter0转换流水线(各文件复用同一个转换器)，
+// 文件之间互不依赖，转换结果按输入顺序交给回调输出
+class EasyMp3BatchConverter
+{
+public:
+    /*
+     * threads：工作线程数，<=0时取CPU核数
+     */
+    EasyMp3BatchConverter(int destSampleRate, int destChannel, int destBitRate, int threads);
+    ~EasyMp3BatchConverter();
+
+    /*
+     * 并行转换files，阻塞到全部完成
+     * callback：按输入顺序输出每个文件的结果，可以为NULL
+     * return：成功转换的文件数
+     */
+    int run(const std::vector<std::string> &files, EasyMp3BatchCallback callback, void *arg);
+
+    int threads() { return m_threads; }
+
+    /* 每个文件内部是否也使用流水线模式转换，见EasyMp3Converter::setPipelined() */
+    void setPipelined(bool enable) { m_pipelined = enable; }
+
+    /* 每个文件的编码线程数，见EasyMp3Converter::setParallelEncode() */
+    void setParallelEncode(int threads) { m_encodeThreads = threads; }
+
+    /* 每个文件的重采样方式，见EasyMp3Converter::setResampleProfile() */
+    void setResampleProfile(EasyMp3ResampleProfile profile) { m_resampleProfile = profile; }
+
+    /* 每个文件的码率控制方式，见EasyMp3Converter::setEncodeProfile() */
+    void setEncodeProfile(EasyMp3EncodeProfile profile) { m_encodeProfile = profile; }
+
+    /* 上一次run()的汇总统计 */
+    unsigned int totalMediaMs() { return m_totalMediaMs; }
+    double totalCostMs() { return m_totalCostMs; } // 墙上时间
+    double realtimeFactor() { return m_totalCostMs > 0 ? m_totalMediaMs / m_totalCostMs : 0; }
+
+private:
+    static void *workerThread(void *arg);
+    void worker();
+    void convertFile(EasyMp3Converter0 &converter, EasyMp3BatchResult &result);
+
+private:
+    int m_destRate, m_destChannel, m_destBitRate;
+    int m_threads;
+    bool m_pipelined;
+    int m_encodeThreads;
+    EasyMp3ResampleProfile m_resampleProfile;
+    EasyMp3EncodeProfile m_encodeProfile;
+
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+
+    const std::vector<std::string> *m_files; // 当前批次的文件列表
+    std::vector<EasyMp3BatchResult *> m_results; // 已完成但还未输出的结果
+    int m_nextJob; // 下一个待分配的文件
+    int m_nextOutput; // 下一个待输出的文件
+    int m_window; // 最多领先输出多少个文件，限制缓存的结果数量
+
+    unsigned int m_totalMediaMs;
+    double m_totalCostMs;
+};
+
+#endif
+
@@ -1,5 +1,25 @@
 #include "easy_mp3_convert.h"
 
+#define PARALLEL_ENCODE_FRAMES 64 // 并行编码时每个线程每次编码的帧数
+#define STREAM_BUFFER_SIZE (16 * 1024) // 流式输入的缓冲区大小
+
+// 兼容按帧返回vector的接口：每次write()的数据作为一帧
+class EasyMp3FrameListSink : public EasyMp3Sink
+{
+public:
+    EasyMp3FrameListSink(std::vector<std::vector<unsigned char> > &frames) : m_frames(frames) {}
+
+    bool write(const unsigned char *data, int size)
+    {
+        m_frames.push_back(std::vector<unsigned char>(data, data + size));
+        m_bytes += size;
+        return true;
+    }
+
+private:
+    std::vector<std::vector<unsigned char> > &m_frames;
+};
+
 
 /*
  * mp3FileName：待重编码MP3文件
@@ -9,13 +29,38 @@
  */
 EasyMp3Converter::EasyMp3Converter(const std::string &mp3FileName,
     int destSampleRate, int destChannel, int destBitRate)
+{
+    init(destSampleRate, destChannel, destBitRate);
+    m_parser = new Mp3FileParse(mp3FileName); // MP3帧解析器
+}
+
+/*
+ * 流式输入：不打开文件，由push()送入MP3数据，pull()取出重编码后的数据
+ * 参数同上
+ */
+EasyMp3Converter::EasyMp3Converter(int destSampleRate, int destChannel, int destBitRate)
+{
+    init(destSampleRate, destChannel, destBitRate);
+    m_stream = new Mp3StreamParse(STREAM_BUFFER_SIZE);
+    m_passthrough = 0; // 不能预先扫描，逐帧比较
+}
+
+void EasyMp3Converter::init(int destSampleRate, int destChannel, int destBitRate)
 {
     m_decodedBuf.Init(32 * 1024); // 保存MP3解码后的PCM数据
-    m_resamplerBuf.Init(32 * 1024); // 保存PCM重采样后的数据
+    m_resamplerBuf.Init(64 * 1024); // 保存PCM重采样后的数据，须能放下一次重采样的输出
 
     m_decoder = EasyMp3DecoderCreate(); // MP3解码器
+    m_resampler = NULL; // PCM重采样器，需要时再创建
+    m_polyResampler = NULL;
+    m_resampleProfile = EASY_MP3_RESAMPLE_SINC_BEST;
+    m_resamplerReady = false;
+    m_resamplerRate = m_resamplerChannels = 0;
+    m_resamplerProfile = EASY_MP3_RESAMPLE_SINC_BEST;
 
-    m_parser = new Mp3FileParse(mp3FileName); // MP3帧解析器
+    m_parser = NULL;
+    m_stream = NULL;
+    m_streamStatus = MPEG_AUDIO_NEED_MORE;
 
     m_encoder = new EasyMp3Encoder(); // MP3编码器
     m_encoder->start(destBitRate, destSampleRate, destChannel);
@@ -23,25 +68,31 @@ EasyMp3Converter::EasyMp3Converter(const std::string &mp3FileName,
     m_destBitRate = destBitRate;
     m_destChannel = destChannel;
     m_destRate = destSampleRate;
+
+    m_pipelined = false; // 默认在调用线程中顺序处理
+    m_pipeEnd = false;
+    m_threadNum = 0;
+    m_pipeStop = false;
+    m_encodeThreads = 1;
+    m_encodeChunkPos = 0;
+    m_passthrough = -1; // 第一次转换或跳转时再探测
 }
 
 EasyMp3Converter::~EasyMp3Converter()
 {
+    stopPipeline(); // 先停止流水线线程，再释放各模块
+
     if (m_decoder)
         EasyMp3DecoderDestroy(m_decoder);
     m_decoder = 0;
 
-    if (m_parser)
-        delete m_parser;
-    m_parser = 0;
+    closeInput();
 
     if (m_encoder)
         delete m_encoder;
     m_encoder = 0;
 
-    if (m_resampler)
-        delete m_resampler;
-    m_resampler = 0;
+    destroyResampler();
 }
 
 /* 单双声道互转
@@ -65,22 +116,17 @@ int EasyMp3Converter::operateMonoStereo(int channel, int origin_channel, char *i
         if (origin_channel == 1 && channel == 2) // 单声道转双声道
         {
             short *ptr = (short *)in_ptr;
-            char *tmp = new char[in_size << 1];
-            short *ptr1 = (short *)tmp;
-
-            for (int i = 0; i < in_size >> 1; i++)
-            {
-                ptr1[2 * i] = ptr1[2 * i + 1] = ptr[i];
-            }
+            short *ptr1 = (short *)out_ptr;
 
             if (out_size >= (in_size << 1))
             {
-                memcpy(out_ptr, ptr1, (in_size << 1));
-                delete[]tmp;
+                // 从后往前写，in_ptr与out_ptr相同时也不会覆盖未处理的数据
+                for (int i = (in_size >> 1) - 1; i >= 0; i--)
+                {
+                    ptr1[2 * i] = ptr1[2 * i + 1] = ptr[i];
+                }
                 return (in_size << 1);
             }
-
-            delete[]tmp;
             return -1; // 缓冲区不够
         }
         else if (origin_channel == 2 && channel == 1) // 双声道转单声道
@@ -104,115 +150,851 @@ int EasyMp3Converter::operateMonoStereo(int channel, int origin_channel, char *i
     }
 }
 
+/*
+ * 读取并解码一帧MP3数据
+ * mp3_data/mp3_size：原MP3帧，指向文件映射区
+ * pcm_data：解码后的PCM数据，缓冲区大小须不小于16*1152字节
+ * return：成功返回true，没有数据或者解码失败返回false
+ */
+bool EasyMp3Converter::decodeFrame(const unsigned char *&mp3_data, int &mp3_size, char *pcm_data, int &pcm_bytes,
+    int &samplerate, int &channels)
+{
+    /* 获取一帧原MP3编码数据 */
+    if (!readFrame(mp3_data, mp3_size))
+        return false;
+
+    /* 进行解码 */
+    int mp3_bytes = mp3_size;
+    pcm_bytes = 16 * 1152;
+
+    int ret = EasyMp3DecoderDecode(m_decoder, mp3_data, mp3_bytes, (unsigned char *)pcm_data, pcm_bytes);
+    if (ret != 0 || pcm_bytes <= 0)
+        return false;
+
+    int bitrate;
+    EasyMp3DecoderInfo(m_decoder, samplerate, channels, bitrate);
+    return true;
+}
+
+/* 从文件或者流式输入中取一帧，流式输入没有完整的帧时返回false */
+bool EasyMp3Converter::readFrame(const unsigned char *&mp3_data, int &mp3_size)
+{
+    if (m_stream)
+    {
+        m_streamStatus = m_stream->GetNextFrame(mp3_data, mp3_size);
+        return m_streamStatus == MPEG_AUDIO_OK;
+    }
+    return m_parser->GetNextFrame(mp3_data, mp3_size);
+}
+
+/* 流式输入是否还没有结束，结束之前不能冲刷编码器中攒下的数据 */
+bool EasyMp3Converter::waitingInput()
+{
+    return m_stream && m_streamStatus != MPEG_AUDIO_ERR;
+}
+
+/*
+ * 等待m_resamplerBuf有need字节的空闲空间
+ * wait：流水线模式下为true，阻塞到编码线程取走数据或者流水线停止；顺序模式下空间不够直接返回false
+ */
+bool EasyMp3Converter::waitResamplerSpace(int need, bool wait)
+{
+    if (m_resamplerBuf.GetFreeLength() >= need)
+        return true;
+
+    if (wait && m_resamplerBuf.WaitFree(need, m_pipeStop))
+        return true;
+
+    if (!m_pipeStop)
+        LOGW_RATELIMIT(1000, "resample buffer overflow, drop %d bytes\n", need);
+    return false;
+}
+
+/*
+ * 对解码后的PCM数据进行声道转换和重采样，结果直接写入m_resamplerBuf
+ * wait：m_resamplerBuf空间不够时是否等待消费者
+ */
+void EasyMp3Converter::resamplePcm(char *pcm_data, int pcm_bytes, int samplerate, int channels, bool wait)
+{
+    char out_data[16 * 1152];
+
+    /* 目标是单声道时先转成单声道，重采样的数据量减半；
+     * 否则按原声道数重采样，最后再做单双声道转换 */
+    if (channels == 2 && m_destChannel == 1)
+    {
+        pcm_bytes = operateMonoStereo(1, 2, pcm_data, pcm_bytes, pcm_data, pcm_bytes);
+        channels = 1;
+    }
+
+    int samples_per_frame = (samplerate / 1000) * channels * 20; // 原PCM数据一帧的采样点数
+
+    if ((samplerate != m_destRate) && !m_resamplerReady) // 创建或者复位重采样器
+        createResampler(samplerate, channels, samples_per_frame);
+
+    m_decodedBuf.Cover((unsigned char *)pcm_data, pcm_bytes); // 保存解码后的PCM数据
+
+    /* 进行重采样：默认位宽16bit */
+    int real_size = 0;
+    int frame_size = samples_per_frame * 16 / 8; // 原PCM数据一帧的字节数
+    short out_ptr[8192];
+    unsigned char data[48 * 2 * 20 * 2]; // 原PCM数据一帧，最大为48000Hz双声道20ms
+
+    if (frame_size > (int)sizeof(data))
+    {
+        LOGE("unsupported pcm: %d Hz, %d channels\n", samplerate, channels);
+        return;
+    }
+
+    while (m_decodedBuf.GetLength() >= frame_size)
+    {
+        if (m_decodedBuf.Read(data, frame_size) != frame_size) // 获取解码后的PCM数据
+            break;
+
+        if (samplerate != m_destRate && m_polyResampler) // 内置重采样，输出的帧数不固定
+        {
+            int frames = m_polyResampler->resample_run((short *)data, samples_per_frame / channels, out_ptr,
+                sizeof(out_ptr) / sizeof(short) / channels);
+            real_size = frames * channels * 2; // 单位字节
+        }
+        else if (samplerate != m_destRate) // 需要重采样
+        {
+            unsigned int osize = m_resampler->resample_get_output_size(); // 重采样后的采样点数
+            real_size = osize << 1; // 单位字节
+            m_resampler->resample_run((short *)data, out_ptr);
+        }
+        else // 不需要重采样
+        {
+            memcpy(out_ptr, data, frame_size);
+            real_size = frame_size;
+        }
+
+        /* 单双声道转换，结果保存到m_resamplerBuf */
+        int need = real_size * m_destChannel / channels;
+        if (!waitResamplerSpace(need, wait))
+            break;
+
+        int len = 0;
+        unsigned char *dst = m_resamplerBuf.PeekWrite(len);
+        if (len >= need) // 直接写入环形缓冲区
+        {
+            int ret = operateMonoStereo(m_destChannel, channels, (char *)out_ptr, real_size, (char *)dst, len);
+            if (ret > 0)
+                m_resamplerBuf.CommitWrite(ret);
+        }
+        else // 在缓冲区尾部折返，经临时缓冲区写入
+        {
+            int ret = operateMonoStereo(m_destChannel, channels, (char *)out_ptr, real_size, out_data, sizeof(out_data));
+            if (ret > 0)
+                m_resamplerBuf.Write((unsigned char *)out_data, ret);
+        }
+    }
+}
+
+/*
+ * 按m_resampleProfile创建重采样器，
+ * 内置重采样器不支持该采样率组合时改用libsamplerate
+ * 上一个文件留下的重采样器参数相同时只复位，不重新创建
+ */
+void EasyMp3Converter::createResampler(int samplerate, int channels, int samples_per_frame)
+{
+    if ((m_resampler || m_polyResampler) && samplerate == m_resamplerRate &&
+        channels == m_resamplerChannels && m_resampleProfile == m_resamplerProfile)
+    {
+        m_resamplerReady = true;
+        if (m_resampler)
+            m_resampler->resample_reset();
+        else
+            m_polyResampler->resample_reset();
+        return;
+    }
+
+    destroyResampler();
+    m_resamplerReady = true;
+    m_resamplerRate = samplerate;
+    m_resamplerChannels = channels;
+    m_resamplerProfile = m_resampleProfile;
+
+    if (m_resampleProfile >= EASY_MP3_RESAMPLE_POLY_FAST)
+    {
+        static const ResampleQuality qualities[] = { RESAMPLE_QUALITY_FAST, RESAMPLE_QUALITY_MEDIUM, RESAMPLE_QUALITY_HIGH };
+        m_polyResampler = new CResamplePoly();
+        if (m_polyResampler->resample_create(qualities[m_resampleProfile - EASY_MP3_RESAMPLE_POLY_FAST],
+            channels, samplerate, m_destRate) == 0)
+            return;
+
+        LOGW("poly resampler does not support %d -> %d, use libsamplerate\n", samplerate, m_destRate);
+        delete m_polyResampler;
+        m_polyResampler = NULL;
+    }
+
+    // high_quality, large_filter：BEST(1,1)，MEDIUM(1,0)，FASTEST(0,1)，LINEAR(0,0)
+    bool high_quality = m_resampleProfile == EASY_MP3_RESAMPLE_SINC_BEST || m_resampleProfile == EASY_MP3_RESAMPLE_SINC_MEDIUM;
+    bool large_filter = m_resampleProfile == EASY_MP3_RESAMPLE_SINC_BEST || m_resampleProfile == EASY_MP3_RESAMPLE_SINC_FASTEST;
+    if (m_resampleProfile >= EASY_MP3_RESAMPLE_POLY_FAST)
+        high_quality = large_filter = true;
+
+    m_resampler = new CResampleEx();
+    m_resampler->resample_create(high_quality, large_filter, channels, samplerate, m_destRate, samples_per_frame);
+}
+
+void EasyMp3Converter::destroyResampler()
+{
+    if (m_resampler)
+        delete m_resampler;
+    m_resampler = NULL;
+
+    if (m_polyResampler)
+        delete m_polyResampler;
+    m_polyResampler = NULL;
+    m_resamplerReady = false;
+}
+
+/*
+ * 设置重采样方式，须在开始转换之前调用，
+ * 默认EASY_MP3_RESAMPLE_SINC_BEST，语音类的低采样率输出可以选择更快的方式
+ */
+void EasyMp3Converter::setResampleProfile(EasyMp3ResampleProfile profile)
+{
+    m_resampleProfile = profile;
+}
+
+/*
+ * 设置码率控制方式，默认EASY_MP3_ENCODE_DEFAULT，
+ * EASY_MP3_ENCODE_FAST编码更快，音质略有差别
+ */
+void EasyMp3Converter::setEncodeProfile(EasyMp3EncodeProfile profile)
+{
+    m_encoder->setProfile(profile);
+}
+
+/*
+ * 把m_resamplerBuf中满一帧的PCM数据编码，编码后的帧追加到buffer中
+ * eos：数据已经结束，并行编码时把攒下的数据全部编码，顺序编码时冲刷编码器输出最后一帧的剩余部分
+ */
+bool EasyMp3Converter::encodePcm(EasyMp3Sink *sink, bool eos)
+{
+    if (m_encodeThreads > 1)
+        return encodePcmParallel(sink, eos);
+
+    bool ok = true;
+
+    int samples = m_encoder->samples();
+    int encode_data_len = samples * 16 / 8;
+    unsigned char encode_data[1152 * 2 * 2]; // 一帧最多1152个采样点，双声道
+
+    while (ok && m_resamplerBuf.GetLength() >= encode_data_len)
+    {
+        int len = 0;
+        const unsigned char *src = m_resamplerBuf.PeekRead(len);
+        bool direct = (len >= encode_data_len); // 一帧数据是连续的，直接在环形缓冲区上编码
+
+        if (!direct)
+        {
+            if (m_resamplerBuf.Read(encode_data, encode_data_len) != encode_data_len)
+                break;
+            src = encode_data;
+        }
+
+        short *pOut = 0;
+        int ret = m_encoder->encode((const short *)src, encode_data_len / sizeof(short), &pOut);
+        if (direct)
+            m_resamplerBuf.CommitRead(encode_data_len);
+
+        if (ret > 0) // 直接从编码器的比特流缓冲区写出
+            ok = sink->write((const unsigned char *)pOut, ret * sizeof(short));
+    }
+
+    if (ok && eos) // 再次调用时缓存已空，不会重复输出
+    {
+        unsigned char *rest = NULL;
+        int ret = m_encoder->flush(&rest);
+        if (ret > 0)
+            ok = sink->write(rest, ret);
+    }
+    return ok;
+}
+
+/* 并行编码：每个线程攒够PARALLEL_ENCODE_FRAMES帧后一起编码，编码结果逐帧写入sink */
+bool EasyMp3Converter::encodePcmParallel(EasyMp3Sink *sink, bool eos)
+{
+    if (m_encodeChunkPos > 0) // 丢弃已经编码的数据，只剩不足一帧的数据需要搬移
+    {
+        m_encodeChunk.erase(m_encodeChunk.begin(), m_encodeChunk.begin() + m_encodeChunkPos);
+        m_encodeChunkPos = 0;
+    }
+
+    int len = 0;
+    const unsigned char *src = m_resamplerBuf.PeekRead(len);
+    while (len > 0) // 取出m_resamplerBuf中的全部数据
+    {
+        m_encodeChunk.insert(m_encodeChunk.end(), (const short *)src, (const short *)(src + len));
+        m_resamplerBuf.CommitRead(len);
+        src = m_resamplerBuf.PeekRead(len);
+    }
+
+    int chunk_len = m_encoder->samples() * PARALLEL_ENCODE_FRAMES * m_encodeThreads;
+    if ((int)m_encodeChunk.size() < chunk_len && !eos)
+        return true;
+
+    m_encodeOut.clear();
+    m_encodeFrameSizes.clear();
+    int ret = m_encoder->encodeParallel(m_encodeChunk.data(), m_encodeChunk.size(), m_encodeOut,
+        m_encodeFrameSizes, m_encodeThreads);
+    if (ret > 0)
+        m_encodeChunkPos = ret;
+
+    size_t pos = 0;
+    for (size_t i = 0; i < m_encodeFrameSizes.size(); i++) // 与顺序编码一样，每次write()一帧
+    {
+        if (!sink->write(m_encodeOut.data() + pos, m_encodeFrameSizes[i]))
+            return false;
+        pos += m_encodeFrameSizes[i];
+    }
+    return true;
+}
+
 /* 获取一帧/多帧重编码后的MP3数据 */
 bool EasyMp3Converter::convert(std::vector<std::vector<unsigned char> > &buffer)
 {
-    int ret = -1, try_time = 2;
-    bool res = false;
-    char pcm_data[16 * 1152] = { 0 };
-    int pcm_bytes = 0, mp3_bytes = 0;
-    std::vector<unsigned char> mp3_data;
-
     buffer.clear();
 
-    while (buffer.size() == 0 && (try_time--))
+    if (m_pipelined && !passthrough()) // 流水线输出的本来就是一帧一个vector
+        return pipelineConvert(buffer);
+
+    EasyMp3FrameListSink sink(buffer);
+    return convert(&sink);
+}
+
+/*
+ * 获取一帧/多帧重编码后的MP3数据，直接写入sink
+ * return：写入了数据返回true，数据结束或者sink出错返回false
+ */
+bool EasyMp3Converter::convert(EasyMp3Sink *sink)
+{
+    int try_time = 2;
+    char pcm_data[16 * 1152]; // 由解码器填充
+    int pcm_bytes = 0;
+    const unsigned char *mp3_data = NULL; // 指向文件映射区，无需拷贝
+    int mp3_size = 0;
+    unsigned long start = sink->bytes();
+
+    if (passthrough())
+        return passthroughConvert(sink);
+
+    if (m_pipelined)
     {
-        /* 获取一帧原MP3编码数据 */
-        res = m_parser->GetNextFrame(mp3_data);
-        if (!res)
+        if (!pipelineConvert(m_pipeFrames))
             return false;
+        for (size_t i = 0; i < m_pipeFrames.size(); i++)
+        {
+            if (!sink->write(m_pipeFrames[i].data(), m_pipeFrames[i].size()))
+                return false;
+        }
+        return true;
+    }
 
-        /* 进行解码 */
-        pcm_bytes = sizeof(pcm_data);
-        mp3_bytes = mp3_data.size();
+    // 并行编码时要攒够多帧数据才有输出，一直读到有输出或者数据结束
+    while (sink->bytes() == start && (m_encodeThreads > 1 || try_time--))
+    {
+        int samplerate, channels;
+        if (!decodeFrame(mp3_data, mp3_size, pcm_data, pcm_bytes, samplerate, channels))
+        {
+            if (!waitingInput()) // 数据结束：编码攒下的数据，冲刷编码器
+            {
+                if (!encodePcm(sink, true))
+                    return false;
+            }
+            return sink->bytes() > start;
+        }
 
-        ret = EasyMp3DecoderDecode(m_decoder, mp3_data.data(), mp3_bytes,
-            (unsigned char *)pcm_data, pcm_bytes);
+        if (samplerate == m_destRate && channels == m_destChannel)
+        {
+            if (m_stream) // 指向流式输入的缓冲区，下一次取帧时失效
+                return sink->write(mp3_data, mp3_size);
+            return sink->writeStable(mp3_data, mp3_size);
+        }
+
+        resamplePcm(pcm_data, pcm_bytes, samplerate, channels, false);
 
-        if (ret != 0 || pcm_bytes <= 0)
+        /* 进行重编码 */
+        if (!encodePcm(sink, false))
             return false;
+    }
 
-        int samplerate, channels, bitrate;
-        EasyMp3DecoderInfo(m_decoder, samplerate, channels, bitrate);
-        if (samplerate == m_destRate && channels == m_destChannel)
+    return sink->bytes() > start;
+}
+
+/*
+ * 流式输入：送入任意长度的MP3数据
+ * return：接收的字节数，内部缓冲区满时少于size，须先pull()取走数据再送入剩余部分
+ */
+int EasyMp3Converter::push(const unsigned char *data, int size)
+{
+    if (!m_stream)
+        return 0;
+    return m_stream->Push(data, size);
+}
+
+/* 流式输入：数据已经全部送入 */
+void EasyMp3Converter::pushEnd()
+{
+    if (!m_stream)
+        return;
+    m_stream->PushEnd();
+}
+
+/*
+ * 流式输入：取出当前可以输出的重编码数据
+ * return：MPEG_AUDIO_OK取到了数据；MPEG_AUDIO_NEED_MORE需要push()更多数据；
+ *         MPEG_AUDIO_ERR数据已经全部输出
+ */
+int EasyMp3Converter::pull(std::vector<std::vector<unsigned char> > &buffer)
+{
+    buffer.clear();
+    EasyMp3FrameListSink sink(buffer);
+    return pull(&sink);
+}
+
+/* 流式输入：取出当前可以输出的重编码数据，直接写入sink */
+int EasyMp3Converter::pull(EasyMp3Sink *sink)
+{
+    if (!m_stream)
+        return MPEG_AUDIO_ERR;
+
+    while (!convert(sink))
+    {
+        if (m_streamStatus != MPEG_AUDIO_OK) // 没有完整的帧了
+            return m_streamStatus;
+        // 读到了帧但解码失败(如比特池数据不足)，继续下一帧
+    }
+    return MPEG_AUDIO_OK;
+}
+
+/*
+ * 原文件是否已经是目标格式：只解析第一帧的帧头(与近似跳转共用，不扫描整个文件)，
+ * 是采样率、声道数与目标相同的Layer III帧时，原始帧可以直接输出，不需要解码；
+ * 之后的帧由passthroughConvert()在输出时逐帧检查
+ */
+bool EasyMp3Converter::passthrough()
+{
+    if (m_passthrough < 0)
+    {
+        const MpegAudioFrameInfo *info = m_parser->GetFirstFrameInfo();
+        m_passthrough = (info && passthroughFrame(*info)) ? 1 : 0;
+        if (m_passthrough)
+            LOG("passthrough: %d Hz, %d ch, %d kbps\n", info->samplerate, m_destChannel, info->bitrate);
+    }
+    return m_passthrough == 1;
+}
+
+/* 该帧能否原样输出：采样率、声道数与目标相同的Layer III帧 */
+bool EasyMp3Converter::passthroughFrame(const MpegAudioFrameInfo &info)
+{
+    int channels = info.channelMode == 1 ? 1 : 2; // 1为单声道，其余都是双声道
+    return info.layer == 3 && info.samplerate == m_destRate && channels == m_destChannel;
+}
+
+/* 直通模式：原样输出下一帧，遇到格式不同的帧时退回该帧，之后解码重编码 */
+bool EasyMp3Converter::passthroughConvert(EasyMp3Sink *sink)
+{
+    const unsigned char *mp3_data = NULL; // 指向文件映射区，在转换器销毁之前有效
+    int mp3_size = 0;
+    MpegAudioFrameInfo info;
+
+    if (!m_parser->GetNextFrame(mp3_data, mp3_size, &info))
+        return false;
+
+    if (!passthroughFrame(info))
+    {
+        LOG("passthrough stopped: frame of %d Hz, layer %d\n", info.samplerate, info.layer);
+        m_parser->UngetFrame();
+        m_passthrough = 0;
+        return convert(sink);
+    }
+    return sink->writeStable(mp3_data, mp3_size);
+}
+
+/*
+ * 设置编码线程数，大于1时按帧并行编码(见EasyMp3Encoder::encodeParallel())，
+ * 适合离线转换长文件，须在开始转换之前调用
+ */
+void EasyMp3Converter::setParallelEncode(int threads)
+{
+    m_encodeThreads = threads > 1 ? threads : 1;
+}
+
+/*
+ * 开启/关闭流水线模式：解码、重采样、编码分别在独立线程中运行，
+ * 相邻两级之间通过有界队列传递数据，队列满时上游阻塞等待
+ */
+void EasyMp3Converter::setPipelined(bool enable)
+{
+    if (enable && m_stream) // 解码线程不能等待push()的数据
+    {
+        LOGW("pipeline is not supported for stream input\n");
+        return;
+    }
+
+    if (!enable)
+        stopPipeline();
+    m_pipelined = enable;
+}
+
+void *EasyMp3Converter::decodeThread(void *arg)
+{
+    ((EasyMp3Converter *)arg)->decodeLoop();
+    return NULL;
+}
+
+void *EasyMp3Converter::resampleThread(void *arg)
+{
+    ((EasyMp3Converter *)arg)->resampleLoop();
+    return NULL;
+}
+
+void *EasyMp3Converter::encodeThread(void *arg)
+{
+    ((EasyMp3Converter *)arg)->encodeLoop();
+    return NULL;
+}
+
+/* 解码线程：读帧、解码，原样输出的帧直接往下传 */
+void EasyMp3Converter::decodeLoop()
+{
+    char pcm_data[16 * 1152];
+    const unsigned char *mp3_data = NULL;
+    int mp3_size = 0, pcm_bytes = 0;
+
+    while (true)
+    {
+        EasyMp3PipeItem *item = new EasyMp3PipeItem();
+        item->type = EASY_MP3_PIPE_END;
+
+        if (decodeFrame(mp3_data, mp3_size, pcm_data, pcm_bytes, item->samplerate, item->channels))
         {
-            buffer.push_back(mp3_data);
-            return true;
+            if (item->samplerate == m_destRate && item->channels == m_destChannel)
+            {
+                item->type = EASY_MP3_PIPE_FRAME;
+                item->data.assign(mp3_data, mp3_data + mp3_size);
+            }
+            else
+            {
+                item->type = EASY_MP3_PIPE_PCM;
+                item->data.assign(pcm_data, pcm_data + pcm_bytes);
+            }
         }
 
-        /* 双声道转单声道，重采样仅支持单声道，双声道会有问题 */
-        if (channels == 2)
+        int type = item->type;
+        if (!m_decodeQueue.Push(item))
         {
-            pcm_bytes = operateMonoStereo(1, 2, pcm_data, pcm_bytes, pcm_data, sizeof(pcm_data));
-            channels = 1;
+            delete item;
+            break;
         }
+        if (type == EASY_MP3_PIPE_END)
+            break;
+    }
+}
 
-        int samples_per_frame = (samplerate / 1000) * channels * 20; // 原PCM数据一帧的采样点数
+/* 重采样线程：声道转换、重采样 */
+void EasyMp3Converter::resampleLoop()
+{
+    EasyMp3PipeItem *item = NULL;
 
-        if ((samplerate != m_destRate) && (!m_resampler)) // 创建重采样器
+    while (m_decodeQueue.Pop(item))
+    {
+        int type = item->type;
+        if (type == EASY_MP3_PIPE_PCM)
         {
-            m_resampler = new CResampleEx();
-            res = m_resampler->resample_create(true, true, channels, samplerate, m_destRate, samples_per_frame);
+            // 重采样结果直接写入m_resamplerBuf，队列中只传递通知
+            resamplePcm((char *)item->data.data(), item->data.size(), item->samplerate, item->channels, true);
+            item->data.clear();
         }
 
-        m_decodedBuf.Cover((unsigned char *)pcm_data, pcm_bytes); // 保存解码后的PCM数据
+        if (!m_resampleQueue.Push(item))
+        {
+            delete item;
+            break;
+        }
+        if (type == EASY_MP3_PIPE_END)
+            break;
+    }
+}
 
-        /* 进行重采样：默认位宽16bit */
-        int real_size = 0;
-        int frame_size = samples_per_frame * 16 / 8; // 原PCM数据一帧的字节数
-        short out_ptr[8192];
-        unsigned char *data = new unsigned char[frame_size];
+/* 编码线程：把重采样后的PCM编码成MP3帧 */
+void EasyMp3Converter::encodeLoop()
+{
+    EasyMp3PipeItem *item = NULL;
+    std::vector<std::vector<unsigned char> > frames;
 
-        while (m_decodedBuf.GetLength() >= frame_size)
+    while (m_resampleQueue.Pop(item))
+    {
+        int type = item->type;
+        if (type == EASY_MP3_PIPE_PCM || type == EASY_MP3_PIPE_END) // m_resamplerBuf中有新数据或数据结束
         {
-            if (m_decodedBuf.Read(data, frame_size) != frame_size) // 获取解码后的PCM数据
-                break;
+            frames.clear();
+            EasyMp3FrameListSink sink(frames);
+            encodePcm(&sink, type == EASY_MP3_PIPE_END);
 
-            if (samplerate != m_destRate) // 需要重采样
+            bool closed = false;
+            for (size_t i = 0; i < frames.size() && !closed; i++)
             {
-                unsigned int osize = m_resampler->resample_get_output_size(); // 重采样后的采样点数
-                real_size = osize << 1; // 单位字节
-                m_resampler->resample_run((short *)data, out_ptr);
+                EasyMp3PipeItem *out = new EasyMp3PipeItem();
+                out->type = EASY_MP3_PIPE_FRAME;
+                out->data.swap(frames[i]);
+                if (!m_encodeQueue.Push(out))
+                {
+                    delete out;
+                    closed = true;
+                }
             }
-            else // 不需要重采样
+            if (closed)
             {
-                memcpy(out_ptr, data, frame_size);
-                real_size = frame_size;
+                delete item;
+                break;
             }
 
-            ret = operateMonoStereo(m_destChannel, channels, (char *)out_ptr, real_size, pcm_data, sizeof(pcm_data)); // 单双声道转换
-            /* 保存重采样后的PCM数据 */
-            if (ret > 0)
-                m_resamplerBuf.Cover((unsigned char *)pcm_data, ret);
+            if (type == EASY_MP3_PIPE_PCM)
+            {
+                delete item;
+                continue;
+            }
         }
-        delete[]data;
 
-        /* 进行重编码 */
-        int samples = m_encoder->samples();
-        int encode_data_len = samples * 16 / 8;
-        unsigned char *encode_data = new unsigned char[encode_data_len];
+        if (!m_encodeQueue.Push(item))
+        {
+            delete item;
+            break;
+        }
+        if (type == EASY_MP3_PIPE_END)
+            break;
+    }
+}
 
-        while (m_resamplerBuf.GetLength() >= encode_data_len)
+/* 启动流水线线程 */
+bool EasyMp3Converter::startPipeline()
+{
+    m_pipeStop = false;
+    m_decodeQueue.Init(16);
+    m_resampleQueue.Init(16);
+    m_encodeQueue.Init(32);
+
+    void *(*entry[3])(void *) = { decodeThread, resampleThread, encodeThread };
+    for (int i = 0; i < 3; i++)
+    {
+        if (pthread_create(&m_threads[i], NULL, entry[i], this) != 0)
         {
-            if (m_resamplerBuf.Read(encode_data, encode_data_len) != encode_data_len)
-                break;
+            LOGE("can not create pipeline thread %d\n", i);
+            m_threadNum = i;
+            stopPipeline();
+            return false;
+        }
+    }
 
-            short *pOut = 0;
-            ret = m_encoder->encode((const short *)encode_data, encode_data_len / sizeof(short), &pOut);
+    m_threadNum = 3;
+    m_pipeEnd = false;
+    return true;
+}
 
-            if (ret > 0)
-            {
-                const unsigned char *ptr = (const unsigned char *)pOut;
-                std::vector<unsigned char> frame;
+/* 停止流水线线程，丢弃队列中剩余的数据 */
+void EasyMp3Converter::stopPipeline()
+{
+    if (m_threadNum <= 0)
+        return;
 
-                frame.assign(ptr, ptr + ret * sizeof(short));
-                buffer.push_back(frame);
-            }
+    m_pipeStop = true;
+    m_decodeQueue.Close();
+    m_resampleQueue.Close();
+    m_encodeQueue.Close();
+    m_resamplerBuf.Wakeup(); // 重采样线程可能在等待空闲空间
+
+    for (int i = 0; i < m_threadNum; i++)
+        pthread_join(m_threads[i], NULL);
+    m_threadNum = 0;
+
+    EasyMp3PipeItem *item = NULL;
+    while (m_decodeQueue.TryPop(item))
+        delete item;
+    while (m_resampleQueue.TryPop(item))
+        delete item;
+    while (m_encodeQueue.TryPop(item))
+        delete item;
+}
+
+/* 流水线模式下获取重编码后的MP3数据：取出当前已经编码好的所有帧，至少一帧 */
+bool EasyMp3Converter::pipelineConvert(std::vector<std::vector<unsigned char> > &buffer)
+{
+    buffer.clear();
+    if (m_pipeEnd)
+        return false;
+
+    if (m_threadNum <= 0 && !startPipeline())
+        return false;
+
+    EasyMp3PipeItem *item = NULL;
+    if (!m_encodeQueue.Pop(item))
+        return false;
+
+    do
+    {
+        if (item->type == EASY_MP3_PIPE_END)
+        {
+            delete item;
+            m_pipeEnd = true;
+            break;
         }
-        delete[]encode_data;
+        buffer.push_back(std::vector<unsigned char>());
+        buffer.back().swap(item->data);
+        delete item;
+    } while (m_encodeQueue.TryPop(item));
+
+    return buffer.size() > 0;
+}
+
+/*
+ * 跳转前清空各级的状态：停止流水线(下一次convert()时重新启动)，
+ * 复位解码器、重采样器和编码器，丢弃缓存的PCM数据，
+ * 保证跳转后的输出只取决于跳转位置
+ * 各模块只复位不重新创建，重采样器到下一次使用时再复位
+ */
+void EasyMp3Converter::resetStream()
+{
+    stopPipeline();
+    m_pipeEnd = false;
+
+    EasyMp3DecoderReset(m_decoder);
+    m_decodedBuf.Clean();
+    m_resamplerBuf.Clean();
+
+    m_resamplerReady = false; // 需要时再复位或者创建
+
+    if (m_encoder->reset() != 0)
+        m_encoder->start(m_destBitRate, m_destRate, m_destChannel);
+    m_encodeChunk.clear();
+    m_encodeChunkPos = 0;
+}
+
+/* 关闭文件或者流式输入 */
+void EasyMp3Converter::closeInput()
+{
+    if (m_parser)
+        delete m_parser;
+    m_parser = NULL;
+
+    if (m_stream)
+        delete m_stream;
+    m_stream = NULL;
+}
+
+/*
+ * 改为重编码另一个MP3文件，输出参数不变
+ * 解码器、编码器只复位，重采样器到第一次使用时再按源格式复位或者重新创建
+ */
+bool EasyMp3Converter::reopen(const std::string &mp3FileName)
+{
+    resetStream();
+    closeInput();
+
+    m_parser = new Mp3FileParse(mp3FileName);
+    m_streamStatus = MPEG_AUDIO_NEED_MORE;
+    m_passthrough = -1; // 第一次转换或跳转时再探测
+    return m_parser->GetData() != NULL;
+}
+
+/* 开始一段新的流式输入，丢弃未处理的数据 */
+void EasyMp3Converter::reopenStream()
+{
+    resetStream();
+    if (m_parser)
+        delete m_parser;
+    m_parser = NULL;
+
+    if (!m_stream)
+        m_stream = new Mp3StreamParse(STREAM_BUFFER_SIZE);
+    m_stream->Reset();
+    m_streamStatus = MPEG_AUDIO_NEED_MORE;
+    m_passthrough = 0; // 不能预先扫描，逐帧比较
+    m_pipelined = false; // 流式输入不支持流水线模式
+}
+
+/*
+ * 跳转到时间点ms处开始重编码
+ * 跳转后解码器的比特池是空的，目标帧的main_data_begin可能引用前面帧的数据，
+ * 所以从目标帧往前退几帧开始解码(只解码不输出)，把比特池填满
+ */
+bool EasyMp3Converter::seek(unsigned int ms)
+{
+    if (!m_parser) // 流式输入不能跳转
+        return false;
+
+    const Mp3FrameIndex &index = m_parser->GetIndex();
+    int target = index.Find(ms);
+    if (target < 0)
+        return false;
+
+    int start = target, bytes = 0;
+    while (start > 0 && bytes < 511 && target - start < 32) // main_data_begin最大511字节
+    {
+        start--;
+        bytes += index.Size(start);
+    }
+
+    resetStream();
+
+    if (passthrough()) // 不解码，不需要预解码
+        start = target;
+
+    if (!m_parser->SeekToFrame(start))
+        return false;
+
+    char pcm_data[16 * 1152];
+    const unsigned char *mp3_data = NULL;
+    int mp3_size = 0;
+
+    for (int n = start; n < target; n++) // 预解码，丢弃输出
+    {
+        if (!m_parser->GetNextFrame(mp3_data, mp3_size))
+            return false;
+
+        int mp3_bytes = mp3_size, pcm_bytes = sizeof(pcm_data);
+        EasyMp3DecoderDecode(m_decoder, mp3_data, mp3_bytes, (unsigned char *)pcm_data, pcm_bytes);
+    }
+
+    LOG("seek to %u ms: frame %d, preroll %d frames\n", ms, target, target - start);
+    return true;
+}
+
+/*
+ * 近似跳转到时间点ms处开始重编码
+ * 落点帧之前的数据不可用，比特池为空，跳过解码不出数据的帧，直到解码器重新同步
+ */
+bool EasyMp3Converter::seekApprox(unsigned int ms)
+{
+    if (!m_parser)
+        return false;
+
+    resetStream();
+
+    if (!m_parser->SeekApprox(ms))
+        return false;
+
+    char pcm_data[16 * 1152];
+    const unsigned char *mp3_data = NULL;
+    int mp3_size = 0;
+
+    int preroll = passthrough() ? 0 : 32; // 直通模式不解码，不需要预解码
+    for (int n = 0; n < preroll; n++) // 预解码，丢弃输出
+    {
+        if (!m_parser->GetNextFrame(mp3_data, mp3_size))
+            return false;
+
+        int mp3_bytes = mp3_size, pcm_bytes = sizeof(pcm_data);
+        EasyMp3DecoderDecode(m_decoder, mp3_data, mp3_bytes, (unsigned char *)pcm_data, pcm_bytes);
+        if (pcm_bytes > 0) // 比特池已经可用
+            break;
     }
 
-    return buffer.size();
+    LOG("approx seek to %u ms\n", ms);
+    return true;
 }
 
 /*
@@ -225,6 +1007,10 @@ EasyMp3Converter0::EasyMp3Converter0(int destSampleRate, int destChannel, int de
     m_destBitRate = destBitRate;
     m_destChannel = destChannel;
     m_destRate = destSampleRate;
+    m_pipelined = false;
+    m_encodeThreads = 1;
+    m_resampleProfile = EASY_MP3_RESAMPLE_SINC_BEST;
+    m_encodeProfile = EASY_MP3_ENCODE_DEFAULT;
     m_converter = NULL;
 }
 
@@ -238,39 +1024,115 @@ EasyMp3Converter0::~EasyMp3Converter0()
 /* 修改要重编码的MP3文件 */
 bool EasyMp3Converter0::open(const std::string &mp3FileName)
 {
-    if (m_converter) // 删除上一次的转换器
-        delete m_converter;
+    m_buffer.clear(); // 清理上一次的数据，内存留给下一个文件
+    if (m_converter) // 复用上一次的转换器，不重新创建解码器、编码器和重采样器
+        m_converter->reopen(mp3FileName);
+    else
+        m_converter = new EasyMp3Converter(mp3FileName, m_destRate, m_destChannel, m_destBitRate);
+    m_converter->setPipelined(m_pipelined);
+    m_converter->setParallelEncode(m_encodeThreads);
+    m_converter->setResampleProfile(m_resampleProfile);
+    m_converter->setEncodeProfile(m_encodeProfile);
 
-    m_buffer.clear(); // 清理上一次的数据
-    m_converter = new EasyMp3Converter(mp3FileName, m_destRate, m_destChannel, m_destBitRate);
-
-    bool res = m_converter->convert(m_buffer); // 同时获取编码数据
+    bool res = m_converter->convert(&m_buffer); // 同时获取编码数据
     return res;
 }
 
-/* 获取一帧重编码后的MP3数据 */
-bool EasyMp3Converter0::convert(std::vector<unsigned char> &frame)
+/* 跳转到时间点ms处开始重编码，单位ms，须在open()之后调用 */
+bool EasyMp3Converter0::seek(unsigned int ms)
 {
     if (!m_converter)
         return false;
 
-    frame.clear();
-    if (m_buffer.size() > 0) // 当前是否已经有重编码数据
-    {
-        frame.assign(m_buffer[0].data(), m_buffer[0].data() + m_buffer[0].size());
-        m_buffer.erase(m_buffer.begin());
-        return true;
-    }
+    m_buffer.clear(); // 丢弃跳转前已经编码的数据
+    return m_converter->seek(ms);
+}
+
+/* 近似跳转，不扫描整个文件，单位ms，须在open()之后调用 */
+bool EasyMp3Converter0::seekApprox(unsigned int ms)
+{
+    if (!m_converter)
+        return false;
+
+    m_buffer.clear();
+    return m_converter->seekApprox(ms);
+}
+
+/* 开启/关闭流水线模式，对之后open()的文件生效 */
+void EasyMp3Converter0::setPipelined(bool enable)
+{
+    m_pipelined = enable;
+}
+
+/* 设置编码线程数，对之后open()的文件生效 */
+void EasyMp3Converter0::setParallelEncode(int threads)
+{
+    m_encodeThreads = threads;
+}
+
+/* 设置重采样方式，对之后open()的文件生效 */
+void EasyMp3Converter0::setResampleProfile(EasyMp3ResampleProfile profile)
+{
+    m_resampleProfile = profile;
+}
+
+/* 设置码率控制方式，对之后open()的文件生效 */
+void EasyMp3Converter0::setEncodeProfile(EasyMp3EncodeProfile profile)
+{
+    m_encodeProfile = profile;
+}
 
-    bool res = m_converter->convert(m_buffer);
-    if (res)
+/* 原MP3文件总时长，单位ms */
+unsigned int EasyMp3Converter0::duration()
+{
+    if (!m_converter)
+        return 0;
+    return m_converter->duration();
+}
+
+/*
+ * 获取重编码后的MP3数据，直接写入sink，一次可能写入多帧
+ * return：写入了数据返回true，数据结束或者sink出错返回false
+ */
+bool EasyMp3Converter0::convert(EasyMp3Sink *sink)
+{
+    if (!m_converter)
+        return false;
+
+    if (m_buffer.count() > 0) // 之前已经取出的数据
     {
-        frame.assign(m_buffer[0].data(), m_buffer[0].data() + m_buffer[0].size());
-        m_buffer.erase(m_buffer.begin());
-        return true;
+        bool ok = true;
+        const unsigned char *data = NULL;
+        int size = 0;
+        while (ok && m_buffer.front(data, size))
+        {
+            ok = sink->write(data, size);
+            m_buffer.pop();
+        }
+        return ok;
     }
 
-    return false;
+    return m_converter->convert(sink);
+}
+
+/* 获取一帧重编码后的MP3数据 */
+bool EasyMp3Converter0::convert(std::vector<unsigned char> &frame)
+{
+    if (!m_converter)
+        return false;
+
+    frame.clear();
+    if (m_buffer.count() == 0 && !m_converter->convert(&m_buffer)) // 当前没有重编码数据时再转换
+        return false;
+
+    // frame的容量足够时assign()不分配内存，调用者重复使用同一个frame即可
+    const unsigned char *data = NULL;
+    int size = 0;
+    if (!m_buffer.front(data, size))
+        return false;
+    frame.assign(data, data + size);
+    m_buffer.pop();
+    return true;
 }
 
 
@@ -10,36 +10,186 @@
 #include "easy_mp3_decoder.h"
 #include "easy_mp3_encoder.h"
 #include "mp3_file_parse.h"
+#include "mp3_stream_parse.h"
 #include "MediaAudioResampleEx.h"
+#include "MediaAudioResamplePoly.h"
 #include "print_log.h"
 #include "CycleBuffer.h"
+#include "easy_mp3_queue.h"
+#include "easy_mp3_sink.h"
 
+#include <pthread.h>
+#include <atomic>
 #include <string>
 #include <vector>
 using namespace std;
 
+// 流水线中相邻两级之间传递的数据
+enum
+{
+    EASY_MP3_PIPE_PCM = 0, // PCM数据，重采样之后只作通知，数据在m_resamplerBuf中
+    EASY_MP3_PIPE_FRAME, // MP3帧(原样输出的帧或者编码后的帧)
+    EASY_MP3_PIPE_END, // 数据结束
+};
+
+// 重采样方式：在CPU占用和音质之间取舍
+enum EasyMp3ResampleProfile
+{
+    EASY_MP3_RESAMPLE_SINC_BEST = 0, // libsamplerate SRC_SINC_BEST_QUALITY，默认，最慢
+    EASY_MP3_RESAMPLE_SINC_MEDIUM, // libsamplerate SRC_SINC_MEDIUM_QUALITY
+    EASY_MP3_RESAMPLE_SINC_FASTEST, // libsamplerate SRC_SINC_FASTEST
+    EASY_MP3_RESAMPLE_LINEAR, // libsamplerate SRC_LINEAR，音质最差
+    EASY_MP3_RESAMPLE_POLY_FAST, // 内置多相FIR，16阶，适合语音
+    EASY_MP3_RESAMPLE_POLY_MEDIUM, // 内置多相FIR，32阶
+    EASY_MP3_RESAMPLE_POLY_HIGH, // 内置多相FIR，64阶
+};
+
+typedef struct EasyMp3PipeItem
+{
+    int type;
+    int samplerate;
+    int channels;
+    std::vector<unsigned char> data;
+}EasyMp3PipeItem;
+
 // MP3重编码实现
 class EasyMp3Converter
 {
 public:
     EasyMp3Converter(const std::string &mp3FileName, int destSampleRate, int destChannel, int destBitRate);
+
+    /* 流式输入：由push()送入MP3数据，不需要文件，不缓存整个文件 */
+    EasyMp3Converter(int destSampleRate, int destChannel, int destBitRate);
     ~EasyMp3Converter();
 
     /* 获取一帧/多帧重编码后的MP3数据 */
     bool convert(std::vector<std::vector<unsigned char> > &buffer);
 
+    /*
+     * 获取一帧/多帧重编码后的MP3数据，直接写入sink，不生成中间的vector
+     * 原样输出的帧用writeStable()写入，指向文件映射区，sink须在转换器销毁之前flush()
+     */
+    bool convert(EasyMp3Sink *sink);
+
+    /* 跳转到时间点ms处开始重编码，单位ms */
+    bool seek(unsigned int ms);
+
+    /* 近似跳转，不扫描整个文件，适合大文件快速预览，单位ms */
+    bool seekApprox(unsigned int ms);
+
+    /* 原MP3文件总时长，单位ms，流式输入为0 */
+    unsigned int duration() { return m_parser ? m_parser->GetDuration() : 0; }
+
+    /*
+     * 流式输入：push()送入任意长度的数据，pull()取出重编码后的帧，须在同一线程中调用
+     * push()返回接收的字节数，缓冲区满时少于size，pull()之后再送入剩余部分
+     * pull()返回MPEG_AUDIO_OK取到了数据，MPEG_AUDIO_NEED_MORE需要送入更多数据，
+     * MPEG_AUDIO_ERR调用pushEnd()之后数据已经全部取出
+     * 流式输入不支持跳转和流水线模式
+     */
+    int push(const unsigned char *data, int size);
+    void pushEnd();
+    int pull(std::vector<std::vector<unsigned char> > &buffer);
+    int pull(EasyMp3Sink *sink);
+
+    /*
+     * 开启/关闭流水线模式：解码、重采样、编码分别在独立线程中运行，
+     * 相邻两级之间通过有界队列传递数据，适合单个长文件降低转换耗时
+     */
+    void setPipelined(bool enable);
+
+    /*
+     * 设置编码线程数，大于1时按帧并行编码，适合离线转换长文件，
+     * 须在开始转换之前调用
+     */
+    void setParallelEncode(int threads);
+
+    /* 设置重采样方式，须在开始转换之前调用 */
+    void setResampleProfile(EasyMp3ResampleProfile profile);
+
+    /* 设置码率控制方式，见EasyMp3Encoder::setProfile() */
+    void setEncodeProfile(EasyMp3EncodeProfile profile);
+
+    /*
+     * 原文件是否已经是目标格式，是则直接输出原始帧，不解码不编码
+     * 只看第一帧的帧头，之后的帧在输出时逐帧检查，格式改变时从该帧起改为重编码
+     */
+    bool passthrough();
+
+    /*
+     * 改为重编码另一个MP3文件，输出参数不变
+     * 复用解码器、编码器和重采样器(源采样率、声道数相同时)，只重新打开文件，
+     * 输出与新建一个转换器相同；流式输入的转换器调用后改为文件输入
+     * return：文件打开成功返回true
+     */
+    bool reopen(const std::string &mp3FileName);
+
+    /* 开始一段新的流式输入，丢弃未处理的数据，其余同reopen()；文件输入的转换器调用后改为流式输入 */
+    void reopenStream();
+
 private:
+    void init(int destSampleRate, int destChannel, int destBitRate);
+    bool readFrame(const unsigned char *&mp3_data, int &mp3_size);
+    bool waitingInput();
     int operateMonoStereo(int channel, int origin_channel, char *in_ptr, int in_size, char *out_ptr, int out_size);
 
+    bool decodeFrame(const unsigned char *&mp3_data, int &mp3_size, char *pcm_data, int &pcm_bytes,
+        int &samplerate, int &channels);
+    void resamplePcm(char *pcm_data, int pcm_bytes, int samplerate, int channels, bool wait);
+    void createResampler(int samplerate, int channels, int samples_per_frame);
+    void destroyResampler();
+    bool waitResamplerSpace(int need, bool wait);
+    bool encodePcm(EasyMp3Sink *sink, bool eos);
+    bool encodePcmParallel(EasyMp3Sink *sink, bool eos);
+
+    void resetStream();
+    void closeInput();
+    bool passthroughConvert(EasyMp3Sink *sink);
+    bool passthroughFrame(const MpegAudioFrameInfo &info);
+
+    bool startPipeline();
+    void stopPipeline();
+    bool pipelineConvert(std::vector<std::vector<unsigned char> > &buffer);
+    static void *decodeThread(void *arg);
+    static void *resampleThread(void *arg);
+    static void *encodeThread(void *arg);
+    void decodeLoop();
+    void resampleLoop();
+    void encodeLoop();
+
 private:
     int m_destRate, m_destChannel, m_destBitRate;
     CCycleBuffer m_decodedBuf; // 保存MP3解码后的PCM数据
-    CCycleBuffer m_resamplerBuf; // 保存PCM重采样后的数据
+    CSpscCycleBuffer m_resamplerBuf; // 保存PCM重采样后的数据，流水线模式下由重采样线程写、编码线程读
 
-    Mp3FileParse *m_parser; // MP3帧解析器
+    Mp3FileParse *m_parser; // MP3帧解析器，流式输入时为NULL
+    Mp3StreamParse *m_stream; // 流式输入的帧解析器，从文件读取时为NULL
+    int m_streamStatus; // 流式输入最近一次取帧的结果
     void *m_decoder; // MP3解码器
     EasyMp3Encoder *m_encoder; // MP3编码器
-    CResampleEx *m_resampler; // PCM重采样器
+    CResampleEx *m_resampler; // PCM重采样器：libsamplerate
+    CResamplePoly *m_polyResampler; // PCM重采样器：内置多相FIR
+    EasyMp3ResampleProfile m_resampleProfile; // 重采样方式
+    bool m_resamplerReady; // 重采样器是否可以直接使用，复位后为false，需要时再复位或者重新创建
+    int m_resamplerRate, m_resamplerChannels; // 重采样器创建时的源采样率和声道数
+    EasyMp3ResampleProfile m_resamplerProfile; // 重采样器创建时的重采样方式
+    int m_passthrough; // 直通模式：-1未探测，0否，1是
+
+    int m_encodeThreads; // 编码线程数，大于1时并行编码
+    std::vector<short> m_encodeChunk; // 并行编码：攒下的待编码PCM数据
+    size_t m_encodeChunkPos; // m_encodeChunk中已经编码的数据长度，单位short
+    std::vector<unsigned char> m_encodeOut; // 并行编码的输出，重复使用
+    std::vector<int> m_encodeFrameSizes; // m_encodeOut中每一帧的大小
+
+    bool m_pipelined; // 是否为流水线模式
+    bool m_pipeEnd; // 流水线已经输出了全部数据
+    int m_threadNum; // 已经启动的流水线线程数
+    std::atomic<bool> m_pipeStop; // 通知流水线线程退出
+    pthread_t m_threads[3]; // 解码、重采样、编码线程
+    EasyBoundedQueue<EasyMp3PipeItem *> m_decodeQueue; // 解码 -> 重采样
+    EasyBoundedQueue<EasyMp3PipeItem *> m_resampleQueue; // 重采样 -> 编码
+    EasyBoundedQueue<EasyMp3PipeItem *> m_encodeQueue; // 编码 -> convert()
+    std::vector<std::vector<unsigned char> > m_pipeFrames; // 流水线输出写入sink之前的暂存
 };
 
 // 对EasyMp3Converter的改进
@@ -55,10 +205,38 @@ public:
     /* 获取一帧重编码后的MP3数据 */
     bool convert(std::vector<unsigned char> &frame);
 
+    /* 获取重编码后的MP3数据，直接写入sink，见EasyMp3Converter::convert(EasyMp3Sink *) */
+    bool convert(EasyMp3Sink *sink);
+
+    /* 跳转到时间点ms处开始重编码，单位ms，须在open()之后调用 */
+    bool seek(unsigned int ms);
+
+    /* 近似跳转，不扫描整个文件，单位ms，须在open()之后调用 */
+    bool seekApprox(unsigned int ms);
+
+    /* 原MP3文件总时长，单位ms */
+    unsigned int duration();
+
+    /* 开启/关闭流水线模式，对之后open()的文件生效 */
+    void setPipelined(bool enable);
+
+    /* 设置编码线程数，对之后open()的文件生效 */
+    void setParallelEncode(int threads);
+
+    /* 设置重采样方式，对之后open()的文件生效 */
+    void setResampleProfile(EasyMp3ResampleProfile profile);
+
+    /* 设置码率控制方式，对之后open()的文件生效 */
+    void setEncodeProfile(EasyMp3EncodeProfile profile);
+
 private:
     int m_destRate, m_destChannel, m_destBitRate;
+    bool m_pipelined;
+    int m_encodeThreads;
+    EasyMp3ResampleProfile m_resampleProfile;
+    EasyMp3EncodeProfile m_encodeProfile;
     EasyMp3Converter *m_converter;
-    std::vector<std::vector<unsigned char> > m_buffer;
+    EasyMp3FrameArena m_buffer; // 已经编码还未取走的帧
 };
 
 
@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "easy_mp3_decoder.h"
+#include "easy_mp3_stats.h"
 #define MINIMP3_IMPLEMENTATION
 #include "minimp3.h"
 
@@ -44,6 +45,19 @@ void EasyMp3DecoderDestroy(void *handle)
     }
 }
 
+/*
+ * 复位解码器：清空比特池等解码状态，用于跳转(seek)之后
+ */
+void EasyMp3DecoderReset(void *handle)
+{
+    EasyMp3Decoder *decoder = (EasyMp3Decoder *)handle;
+    if (decoder)
+    {
+        mp3dec_init(&decoder->mp3d);
+        memset(&decoder->minfo, 0, sizeof(decoder->minfo));
+    }
+}
+
 /*
  * 解码MP3数据
  * handle：解码句柄
@@ -53,13 +67,15 @@ void EasyMp3DecoderDestroy(void *handle)
  * pcm_bytes：作为输入时表示pcm缓冲区大小，作为输出时表示解码数据的大小，单位byte
  * return：成功返回0，失败返回-1
  */
-int EasyMp3DecoderDecode(void *handle, unsigned char *mp3, int &mp3_bytes, unsigned char *pcm, int &pcm_bytes)
+int EasyMp3DecoderDecode(void *handle, const unsigned char *mp3, int &mp3_bytes, unsigned char *pcm, int &pcm_bytes)
 {
     EasyMp3Decoder *decoder = (EasyMp3Decoder *)handle;
     if (!decoder)
         return -1;
     decoder->minfo.frame_bytes = 0;
+    unsigned long long start = EasyMp3StageBegin();
     int res = mp3dec_decode_frame(&decoder->mp3d, mp3, mp3_bytes, (mp3d_sample_t *)pcm, &decoder->minfo);
+    EasyMp3StageEnd(EASY_MP3_STAGE_DECODE, start);
     mp3_bytes = decoder->minfo.frame_bytes; // 返回消耗掉的MP3数据
     pcm_bytes = res * decoder->minfo.channels * sizeof(mp3d_sample_t); // 解码数据大小：解码成功或跳过ID3/非法数据，需要更多数据进行解码
     return 0;
@@ -16,6 +16,10 @@ void *EasyMp3DecoderCreate(void);
  * 销毁解码器
  */
 void EasyMp3DecoderDestroy(void *handle);
+/*
+ * 复位解码器：清空比特池等解码状态，用于跳转(seek)之后
+ */
+void EasyMp3DecoderReset(void *handle);
 /*
  * 解码MP3数据
  * handle：解码句柄
@@ -25,7 +29,7 @@ void EasyMp3DecoderDestroy(void *handle);
  * pcm_bytes：作为输入时表示pcm缓冲区大小，作为输出时表示解码数据的大小，单位byte
  * return：成功返回0，失败返回-1
  */
-int EasyMp3DecoderDecode(void *handle, unsigned char *mp3, int &mp3_bytes, unsigned char *pcm, int &pcm_bytes);
+int EasyMp3DecoderDecode(void *handle, const unsigned char *mp3, int &mp3_bytes, unsigned char *pcm, int &pcm_bytes);
 /*
  * 获取MP3信息
  * handle：解码句柄
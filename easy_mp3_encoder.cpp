@@ -9,6 +9,9 @@
 #include "easy_mp3_encoder.h"
 #include "shine_mp3.h"
 #include "print_log.h"
+#include "easy_mp3_stats.h"
+#include "easy_mp3_frame_index.h"
+#include <pthread.h>
 
 
 /* wav文件读取 */
@@ -432,6 +435,8 @@ EasyMp3Encoder::EasyMp3Encoder()
     m_samplesPerPass = 576;
     m_encoder = NULL;
     m_config = NULL;
+    m_warmupFrames = 1;
+    m_profile = EASY_MP3_ENCODE_DEFAULT;
 }
 
 EasyMp3Encoder::~EasyMp3Encoder()
@@ -471,15 +476,43 @@ int EasyMp3Encoder::start(int bitrate, int samplerate, int channel)
         LOG("Unsupported samplerate/bitrate configuration\n");
         return -1;
     }
+    shine_set_rate_control(shine, m_profile == EASY_MP3_ENCODE_FAST ? SHINE_RC_FAST : SHINE_RC_DEFAULT);
 
     m_samplesPerPass = shine_samples_per_pass(shine) * channel;
     LOG("samples_per_pass: %d\n", m_samplesPerPass);
 
+    // 一帧的输出取决于之前512个采样点的子带滤波历史和576个采样点的MDCT重叠
+    m_warmupFrames = (512 + 576 + shine_samples_per_pass(shine) - 1) / shine_samples_per_pass(shine);
+    m_history.clear();
+
     m_config = mp3Config;
     m_encoder = shine;
     return 0;
 }
 
+/*
+ * 复位编码器，开始一路新的码流，参数不变
+ * return：成功返回0，未start()时返回-1
+ */
+int EasyMp3Encoder::reset(void)
+{
+    if (!m_encoder || !m_config)
+        return -1;
+
+    m_history.clear();
+    return shine_reset((shine_t)m_encoder, (shine_config_t *)m_config);
+}
+
+/*
+ * 设置码率控制方式，编码器已创建时立即生效
+ */
+void EasyMp3Encoder::setProfile(EasyMp3EncodeProfile profile)
+{
+    m_profile = profile;
+    if (m_encoder)
+        shine_set_rate_control((shine_t)m_encoder, profile == EASY_MP3_ENCODE_FAST ? SHINE_RC_FAST : SHINE_RC_DEFAULT);
+}
+
 void EasyMp3Encoder::stop(void)
 {
     shine_config_t *mp3Config = (shine_config_t *)m_config;
@@ -492,6 +525,7 @@ void EasyMp3Encoder::stop(void)
     if (mp3Config)
         delete mp3Config;
     m_config = NULL;
+    m_history.clear();
 }
 
 /*
@@ -508,11 +542,178 @@ int EasyMp3Encoder::encode(const short *pData, int dlen, short **pOut)
 
     int ret = dlen;
     unsigned char *ptr = NULL;
+    unsigned long long start = EasyMp3StageBegin();
     ptr = shine_encode_buffer_interleaved((shine_t)m_encoder, (short *)pData, &ret);
+    EasyMp3StageEnd(EASY_MP3_STAGE_ENCODE, start);
     *pOut = (short *)ptr;
     return ptr ? ret >> 1 : -1;
 }
 
+/*
+ * 冲刷编码器：shine按32位字输出，最后不足一个字的比特还在缓存中
+ * return：剩余数据长度，单位字节，失败返回-1
+ */
+int EasyMp3Encoder::flush(unsigned char **pOut)
+{
+    if (!m_encoder || !pOut)
+        return -1;
+
+    int written = 0;
+    *pOut = shine_flush((shine_t)m_encoder, &written);
+    return written;
+}
+
+// 并行编码中一段的参数和结果
+typedef struct EncodeSegment
+{
+    EasyMp3Encoder *encoder;
+    const short *pcm;
+    int warmup, start, end; // 预热起始帧、段起始帧、段结束帧(不含)
+    double slotLag; // 预热起始帧的slot lag
+    bool ok;
+    std::vector<unsigned char> out;
+    std::vector<int> frameSizes; // out中每一帧的大小
+}EncodeSegment;
+
+void *EasyMp3Encoder::encodeSegmentThread(void *arg)
+{
+    EncodeSegment *seg = (EncodeSegment *)arg;
+    seg->ok = seg->encoder->encodeSegment(seg->pcm, seg->warmup, seg->start, seg->end, seg->slotLag, seg->out, seg->frameSizes);
+    return NULL;
+}
+
+/*
+ * 用独立的shine实例编码[start, end)帧，从warmup帧开始预热
+ * pcm：整帧PCM数据，帧号从0开始
+ */
+bool EasyMp3Encoder::encodeSegment(const short *pcm, int warmup, int start, int end, double slotLag,
+    std::vector<unsigned char> &out, std::vector<int> &frameSizes)
+{
+    shine_t shine = shine_initialise((shine_config_t *)m_config);
+    if (!shine)
+        return false;
+
+    int written = 0;
+    unsigned char *data = NULL;
+    size_t base = out.size();
+
+    shine_set_rate_control(shine, m_profile == EASY_MP3_ENCODE_FAST ? SHINE_RC_FAST : SHINE_RC_DEFAULT);
+    shine_set_slot_lag(shine, slotLag); // 与顺序编码时的填充位保持一致
+    for (int n = warmup; n < start; n++) // 预热：只为建立滤波器状态，输出丢弃
+        shine_encode_buffer_interleaved(shine, (int16_t *)pcm + n * m_samplesPerPass, &written);
+    shine_flush(shine, &written);
+
+    for (int n = start; n < end; n++)
+    {
+        data = shine_encode_buffer_interleaved(shine, (int16_t *)pcm + n * m_samplesPerPass, &written);
+        out.insert(out.end(), data, data + written);
+    }
+    data = shine_flush(shine, &written); // 段尾正好是帧边界
+    out.insert(out.end(), data, data + written);
+
+    // shine按32位字输出，每次编码的输出不与帧边界对齐；段尾已经冲刷，按帧头切分出每一帧
+    MpegAudioFrameInfo info;
+    long pos = 0, framePos = 0, size = (long)(out.size() - base), split = 0;
+    while (findNextMpegAudioFrame(out.data() + base, size, pos, false, framePos, &info))
+    {
+        frameSizes.push_back((int)(pos - split));
+        split = pos;
+    }
+    if (split < size) // 不应出现：剩余的数据算作最后一帧
+    {
+        if (frameSizes.empty())
+            frameSizes.push_back(0);
+        frameSizes.back() += (int)(size - split);
+    }
+
+    shine_close(shine);
+    return true;
+}
+
+/*
+ * 多线程帧并行编码
+ * return：已编码的数据长度，单位short，失败返回-1
+ */
+int EasyMp3Encoder::encodeParallel(const short *pData, int dlen, std::vector<unsigned char> &out,
+    std::vector<int> &frameSizes, int threads)
+{
+    if (!m_encoder || !pData || dlen < 0)
+        return -1;
+
+    int frameLen = m_samplesPerPass;
+    int frames = dlen / frameLen;
+    if (frames == 0)
+        return 0;
+
+    // 上一次末尾的预热帧拼在前面，第一段也能预热
+    int histFrames = m_history.size() / frameLen;
+    std::vector<short> work;
+    const short *pcm = pData;
+    if (histFrames > 0)
+    {
+        work.reserve((histFrames + frames) * frameLen);
+        work.assign(m_history.begin(), m_history.end());
+        work.insert(work.end(), pData, pData + frames * frameLen);
+        pcm = work.data();
+    }
+    int total = histFrames + frames;
+
+    if (threads > frames)
+        threads = frames;
+    if (threads < 1)
+        threads = 1;
+
+    // 分段，m_encoder只用来推算每段预热起始帧的slot lag，它始终停在历史帧的起始位置
+    shine_t master = (shine_t)m_encoder;
+    std::vector<EncodeSegment> segs(threads);
+    int pos = 0;
+    for (int k = 0; k < threads; k++)
+    {
+        EncodeSegment &seg = segs[k];
+        seg.encoder = this;
+        seg.pcm = pcm;
+        seg.start = histFrames + (int)((long)frames * k / threads);
+        seg.end = histFrames + (int)((long)frames * (k + 1) / threads);
+        seg.warmup = seg.start > m_warmupFrames ? seg.start - m_warmupFrames : 0;
+        seg.ok = false;
+
+        shine_skip_frames(master, seg.warmup - pos);
+        pos = seg.warmup;
+        seg.slotLag = shine_get_slot_lag(master);
+    }
+
+    // 前threads-1段在新线程中编码，最后一段在当前线程中编码
+    std::vector<pthread_t> tids(threads);
+    std::vector<bool> created(threads, false);
+    for (int k = 0; k < threads - 1; k++)
+        created[k] = (pthread_create(&tids[k], NULL, encodeSegmentThread, &segs[k]) == 0);
+    for (int k = 0; k < threads; k++)
+    {
+        if (!created[k]) // 最后一段，或者线程创建失败
+            encodeSegmentThread(&segs[k]);
+    }
+    for (int k = 0; k < threads - 1; k++)
+    {
+        if (created[k])
+            pthread_join(tids[k], NULL);
+    }
+
+    bool ok = true;
+    for (int k = 0; k < threads; k++)
+    {
+        ok = ok && segs[k].ok;
+        out.insert(out.end(), segs[k].out.begin(), segs[k].out.end());
+        frameSizes.insert(frameSizes.end(), segs[k].frameSizes.begin(), segs[k].frameSizes.end());
+    }
+
+    // 保留末尾的预热帧，m_encoder前进到它们的起始位置
+    int keep = total < m_warmupFrames ? total : m_warmupFrames;
+    shine_skip_frames(master, total - keep - pos);
+    m_history.assign(pcm + (total - keep) * frameLen, pcm + total * frameLen);
+
+    return ok ? frames * frameLen : -1;
+}
+
 /*
  * 将WAV文件转换为MP3文件
  * wavFileName: 待转换的wav文件名
@@ -7,6 +7,15 @@
 #ifndef __LIB_EASY_MP3_ENCODER_H__
 #define __LIB_EASY_MP3_ENCODER_H__
 
+#include <vector>
+
+// 码率控制方式
+enum EasyMp3EncodeProfile
+{
+    EASY_MP3_ENCODE_DEFAULT = 0, // shine原有的码率控制，逐步增大量化步长直到比特数不超出
+    EASY_MP3_ENCODE_FAST // 从上一个granule的量化步长开始查找，比特数一超出即停止计数，输出与默认方式不同
+};
+
 class EasyMp3Encoder
 {
 public:
@@ -27,6 +36,20 @@ public:
      */
     void stop(void);
 
+    /*
+     * 复位编码器，开始一路新的码流，参数不变
+     * 复用已有的内存，不重新创建编码器，输出与stop()之后再start()相同
+     * return：成功返回0，未start()时返回-1
+     */
+    int reset(void);
+
+    /*
+     * 设置码率控制方式，默认EASY_MP3_ENCODE_DEFAULT
+     * 可在start()前后调用，reset()后保持不变
+     * 注意：EASY_MP3_ENCODE_FAST时encodeParallel()的结果与顺序编码不再逐字节相同
+     */
+    void setProfile(EasyMp3EncodeProfile profile);
+
     /*
      * encoder PCM data
      * pData: 16bit有符号PCM数据
@@ -36,6 +59,30 @@ public:
      */
     int encode(const short *pData, int dlen, short **pOut);
 
+    /*
+     * 数据结束时输出编码器中还未写出的比特，最后一帧才完整，之后可以继续编码新的码流
+     * pOut：剩余的MP3数据
+     * return：剩余数据长度，单位字节(不一定是short的整数倍)，失败返回-1
+     */
+    int flush(unsigned char **pOut);
+
+    /*
+     * 多线程帧并行编码
+     * 把输入的整帧PCM数据分成threads段，每段由独立的shine实例在各自线程中编码：
+     * 段首之前的几帧先编码一遍(预热，输出丢弃)，使子带滤波和MDCT的历史状态与顺序编码一致；
+     * 本编码器不使用比特池(main_data_begin恒为0)，各段的帧直接拼接就是合法的码流，
+     * 与单实例顺序编码的结果逐字节相同
+     * 注意：同一路码流只能使用encodeParallel()，不要与encode()混用
+     * pData: 16bit有符号PCM数据
+     * dlen：pdata数据长度，单位short，只编码其中的整帧部分
+     * out：编码后的MP3数据追加到out中
+     * frameSizes：out中每一帧的大小依次追加到frameSizes中，按它切分即可逐帧输出
+     * threads：线程数
+     * return：已编码的数据长度，单位short，失败返回-1
+     */
+    int encodeParallel(const short *pData, int dlen, std::vector<unsigned char> &out,
+        std::vector<int> &frameSizes, int threads);
+
     /* 返回一帧的采样点数 */
     int samples() { return m_samplesPerPass; }
 
@@ -51,10 +98,18 @@ private:
     void convert8BitTo16Bit(const unsigned char *input, int insize, short *output);
     void convert16BitTo8Bit(const short *input, int insize, unsigned char *output);
 
+    static void *encodeSegmentThread(void *arg);
+    bool encodeSegment(const short *pcm, int warmup, int start, int end, double slotLag,
+        std::vector<unsigned char> &out, std::vector<int> &frameSizes);
+
 private:
     int m_samplesPerPass; // 576 or 1152, ect
     void *m_encoder;
     void *m_config;
+    EasyMp3EncodeProfile m_profile; // 码率控制方式
+
+    int m_warmupFrames; // 并行编码时每段的预热帧数
+    std::vector<short> m_history; // 并行编码：上一次输入末尾的预热帧，供下一次的第一段预热
 };
 
 
@@ -0,0 +1,188 @@
+/*
+ * MP3帧索引(seek表)
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#include "easy_mp3_frame_index.h"
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+
+/*
+ * 从data+pos开始查找下一帧MPEG音频帧
+ * return：找到完整的一帧返回true，否则返回false
+ */
+bool findNextMpegAudioFrame(const unsigned char *data, long size, long &pos, bool firstFrame,
+    long &framePos, MpegAudioFrameInfo *info)
+{
+    long remain = size - pos;
+    if (!data || remain < 4) // 帧头至少有4个字节
+        return false;
+
+    int bufSize = remain > INT_MAX ? INT_MAX : (int)remain;
+    MpegAudioResult ret = findMpegAudioFramePos((unsigned char *)data + pos, bufSize, info, firstFrame);
+
+    if (ret.errCode != MPEG_AUDIO_OK || info->frameSize < 4)
+        return false;
+
+    if (ret.nextPos > bufSize) // 最后一帧不完整
+        return false;
+
+    framePos = pos + (ret.nextPos - info->frameSize);
+    pos += ret.nextPos;
+    return true;
+}
+
+/* 解析pos处的帧头(不查找)，成功返回true */
+static bool parseMpegAudioHeaderAt(const unsigned char *data, long size, long pos, MpegAudioFrameInfo *info)
+{
+    if (pos + 4 > size || data[pos] != 0xff || (data[pos + 1] & 0xe0) != 0xe0)
+        return false;
+
+    int bufSize = size - pos > 16 ? 16 : (int)(size - pos); // 帧头加CRC足够
+    MpegAudioResult ret = findMpegAudioFramePos((unsigned char *)data + pos, bufSize, info, false);
+    return ret.errCode == MPEG_AUDIO_OK && ret.nextPos == info->frameSize && info->frameSize >= 4;
+}
+
+static bool sameMpegAudioStream(const MpegAudioFrameInfo *a, const MpegAudioFrameInfo *b)
+{
+    return a->mpegVersion == b->mpegVersion && a->layer == b->layer && a->samplerate == b->samplerate;
+}
+
+/*
+ * 从任意位置pos开始重新同步到可靠的帧头
+ * return：找到返回帧的偏移，否则返回-1
+ */
+long resyncMpegAudioFrame(const unsigned char *data, long size, long pos,
+    const MpegAudioFrameInfo *ref, long maxScan)
+{
+    MpegAudioFrameInfo info, next;
+
+    if (!data || pos < 0)
+        return -1;
+
+    long end = pos + maxScan < size ? pos + maxScan : size;
+    for (; pos < end; pos++)
+    {
+        if (!parseMpegAudioHeaderAt(data, size, pos, &info))
+            continue;
+
+        if (ref && !sameMpegAudioStream(&info, ref))
+            continue;
+
+        long nextPos = pos + info.frameSize;
+        if (nextPos > size) // 最后一帧不完整
+            continue;
+
+        if (nextPos == size) // 正好是最后一帧
+            return pos;
+
+        if (parseMpegAudioHeaderAt(data, size, nextPos, &next) && sameMpegAudioStream(&info, &next))
+            return pos;
+    }
+
+    return -1;
+}
+
+Mp3FrameIndex::Mp3FrameIndex()
+{
+    m_duration = 0;
+    m_layer = m_samplerate = m_channels = m_bitrate = 0;
+    m_hasHeader = false;
+    memset(&m_header, 0, sizeof(m_header));
+}
+
+Mp3FrameIndex::~Mp3FrameIndex()
+{
+}
+
+void Mp3FrameIndex::Clear()
+{
+    m_offset.clear();
+    m_size.clear();
+    m_samples.clear();
+    m_timestamp.clear();
+    m_duration = 0;
+    m_layer = m_samplerate = m_channels = m_bitrate = 0;
+    m_hasHeader = false;
+    memset(&m_header, 0, sizeof(m_header));
+}
+
+/*
+ * 扫描整段MP3数据建立索引
+ * return：索引到的帧数
+ */
+int Mp3FrameIndex::Build(const unsigned char *data, long size)
+{
+    MpegAudioFrameInfo info;
+    long pos = 0, framePos = 0;
+    double ms = 0; // 累计时间，避免逐帧取整带来的误差
+    bool firstFrame = true;
+
+    Clear();
+
+    // 按平均帧长预估帧数，减少扩容
+    long estimate = size / 417 + 1;
+    m_offset.reserve(estimate);
+    m_size.reserve(estimate);
+    m_samples.reserve(estimate);
+    m_timestamp.reserve(estimate);
+
+    while (findNextMpegAudioFrame(data, size, pos, firstFrame, framePos, &info))
+    {
+        if (firstFrame && info.bitrateType) // XING/INFO/VBRI帧不含音频数据，不计入索引，保留TOC表
+        {
+            m_header = info;
+            m_hasHeader = true;
+            firstFrame = false;
+            continue;
+        }
+        firstFrame = false;
+
+        m_offset.push_back(framePos);
+        m_size.push_back(info.frameSize);
+        m_samples.push_back(info.samplesPerFrame);
+        m_timestamp.push_back((unsigned int)ms);
+
+        ms += info.samplesPerFrame * 1000.0 / info.samplerate;
+
+        int channels = info.channelMode == 1 ? 1 : 2; // 1为单声道，其余都是双声道
+        if (m_offset.size() == 1)
+        {
+            m_layer = info.layer;
+            m_samplerate = info.samplerate;
+            m_channels = channels;
+            m_bitrate = info.bitrate;
+        }
+        else
+        {
+            if (m_layer != info.layer)
+                m_layer = 0;
+            if (m_samplerate != info.samplerate)
+                m_samplerate = 0;
+            if (m_channels != channels)
+                m_channels = 0;
+            if (m_bitrate != info.bitrate)
+                m_bitrate = 0;
+        }
+    }
+
+    m_duration = (unsigned int)ms;
+    return Count();
+}
+
+/*
+ * 查找包含时间点ms的帧，O(log n)
+ * return：帧序号，超出范围返回-1
+ */
+int Mp3FrameIndex::Find(unsigned int ms) const
+{
+    if (m_timestamp.empty() || ms >= m_duration)
+        return -1;
+
+    // 第一个起始时间大于ms的帧的前一帧
+    std::vector<unsigned int>::const_iterator it = std::upper_bound(m_timestamp.begin(), m_timestamp.end(), ms);
+    return (int)(it - m_timestamp.begin()) - 1;
+}
+
@@ -0,0 +1,87 @@
+/*
+ * MP3帧索引(seek表)
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#ifndef __EASY_MP3_FRAME_INDEX_H__
+#define __EASY_MP3_FRAME_INDEX_H__
+
+#include "easy_mp3_parse_frame.h"
+#include <stddef.h>
+#include <vector>
+
+/*
+ * 从data+pos开始查找下一帧MPEG音频帧
+ * data：MP3数据
+ * size：数据总大小
+ * pos：作为输入时表示开始查找的位置，作为输出时表示再下一帧的查找位置
+ * firstFrame：是否是寻找和解析第一帧数据
+ * framePos：找到的帧的起始偏移
+ * info：帧信息，不能为NULL
+ * return：找到完整的一帧返回true，否则返回false
+ */
+bool findNextMpegAudioFrame(const unsigned char *data, long size, long &pos, bool firstFrame,
+    long &framePos, MpegAudioFrameInfo *info);
+
+/*
+ * 从任意位置pos开始重新同步到可靠的帧头，用于按估算偏移跳转之后
+ * 要求帧头合法，且紧随其后的下一帧帧头的版本、层、采样率与之相同(连续两帧校验)
+ * ref：参考帧信息(一般为第一帧)，不为NULL时还要求与其版本、层、采样率相同
+ * maxScan：最多向后查找的字节数
+ * return：找到返回帧的偏移，否则返回-1
+ */
+long resyncMpegAudioFrame(const unsigned char *data, long size, long pos,
+    const MpegAudioFrameInfo *ref, long maxScan);
+
+// 一次扫描建立的帧索引：记录每帧的偏移、大小、采样点数和起始时间
+// 按结构数组方式存储，按时间二分查找帧
+// 开头的XING/INFO/VBRI帧不含音频数据，不计入索引，帧序号和时间都从第一个音频帧开始
+class Mp3FrameIndex
+{
+public:
+    Mp3FrameIndex();
+    ~Mp3FrameIndex();
+
+    /*
+     * 扫描整段MP3数据建立索引
+     * return：索引到的帧数
+     */
+    int Build(const unsigned char *data, long size);
+    void Clear();
+
+    int Count() const { return (int)m_offset.size(); }
+    long Offset(int n) const { return m_offset[n]; }
+    int Size(int n) const { return m_size[n]; }
+    int Samples(int n) const { return m_samples[n]; }
+    unsigned int Timestamp(int n) const { return m_timestamp[n]; } // 帧起始时间，单位ms
+    unsigned int Duration() const { return m_duration; } // 总时长，单位ms
+
+    /* 全部帧的格式相同时返回该值，不同时返回0，由帧头得出，不需要解码 */
+    int Layer() const { return m_layer; }
+    int SampleRate() const { return m_samplerate; }
+    int Channels() const { return m_channels; }
+    int Bitrate() const { return m_bitrate; } // 单位kbps，VBR文件为0
+
+    /* 开头的XING/INFO/VBRI帧信息，TOC表指向建立索引的数据；没有时返回NULL */
+    const MpegAudioFrameInfo *Header() const { return m_hasHeader ? &m_header : NULL; }
+
+    /*
+     * 查找包含时间点ms的帧，O(log n)
+     * return：帧序号，超出范围返回-1
+     */
+    int Find(unsigned int ms) const;
+
+private:
+    std::vector<long> m_offset; // 帧在数据中的偏移
+    std::vector<unsigned short> m_size; // 帧大小，单位字节
+    std::vector<unsigned short> m_samples; // 每声道采样点数
+    std::vector<unsigned int> m_timestamp; // 帧起始时间，单位ms
+    unsigned int m_duration;
+    int m_layer, m_samplerate, m_channels, m_bitrate; // 全部帧相同的格式，不同为0
+    bool m_hasHeader; // 开头是否有XING/INFO/VBRI帧
+    MpegAudioFrameInfo m_header; // XING/INFO/VBRI帧信息
+};
+
+#endif
+
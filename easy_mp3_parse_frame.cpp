@@ -115,11 +115,15 @@ MpegAudioResult findMpegAudioFramePos(unsigned char *buf, int bufSize, MpegAudio
     // 添加ID3V2标签判断 9-7
     int ID3Size = 0;
     Mp3ID3V23Tag *id3V2_3 = (Mp3ID3V23Tag *)buf;// 查看是否有ID3V2标签
-    if ((id3V2_3->header[0] == 'I') && (id3V2_3->header[1] == 'D') && (id3V2_3->header[2] == '3'))
+    if (bufSize >= 3 && (id3V2_3->header[0] == 'I') && (id3V2_3->header[1] == 'D') && (id3V2_3->header[2] == '3'))
     {
+        // 标签头不完整时不能读取标签大小：buf可能是mmap映射，末尾之后的内存不可访问
+        if (bufSize < (int)sizeof(Mp3ID3V23Tag))
+            return ret;
+
         // 计算标签大小
         ID3Size = (id3V2_3->size[0] << 21) | (id3V2_3->size[1] << 14) | (id3V2_3->size[2] << 7) | (id3V2_3->size[3]) + 10;
-        LOG("ID3Size %d bufSize %d\n", ID3Size, bufSize);
+        LOG_RATELIMIT(1000, "ID3Size %d bufSize %d\n", ID3Size, bufSize); // 流式输入时每次送入数据都可能走到这里
         if (ID3Size > bufSize)
         {
             ret.nextPos = ID3Size + 1152 * 2; // 至少需要这么多数据
@@ -434,6 +438,7 @@ int parseVbrXINGHdr(unsigned char *xingHdr, int bufSize, MpegAudioFrameInfo *inf
 		if (bufSize < offset+100)
 			return MPEG_AUDIO_NEED_MORE;
 
+		info->TOCTable = xingHdr + offset;
 		offset += 100;
 	}
 
@@ -535,6 +540,13 @@ int parseVbrVBRIHdr(unsigned char *vbriHdr, int bufSize, MpegAudioFrameInfo *inf
 
 	offset += 2;
 
+	// TOC table follows the header
+	if (info->entriesNumInTOCTable > 0 && entrySize >= 1 && entrySize <= 4
+		&& bufSize >= 26 + info->entriesNumInTOCTable * entrySize)
+	{
+		info->TOCTable = offset;
+	}
+
 	return MPEG_AUDIO_OK;
 }
 
@@ -550,7 +562,7 @@ int bigendian2Local(unsigned char *valueAddr, int len)
 {
 	if (len <= 0 || len % 2 != 0)
 		return -1;
-	if (isBigendian())
+	if (!isBigendian()) // 小端机器上才需要交换字节序
 	{
 		exchangeByteEndian(valueAddr, len);
 	}
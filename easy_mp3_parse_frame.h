@@ -182,6 +182,14 @@ typedef struct MpegAudioFrameInfo
 	 */
 	short int framesNumPerTable;
 
+	/*
+	 * TOC table, points into the parsed buffer (only valid while it lives)
+	 * XING: 100 entries, 1 byte each
+	 * VBRI: entriesNumInTOCTable entries, entrySize bytes each (big-endian)
+	 * NULL if not present
+	 */
+	const unsigned char *TOCTable;
+
 	/*
 	 * VBRI delay
 	 * Delay as Big-Endian float
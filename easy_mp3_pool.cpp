@@ -0,0 +1,158 @@
+/*
+ * MP3转换器池
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#include "easy_mp3_pool.h"
+
+/*
+ * destSampleRate/destChannel/destBitRate：同EasyMp3Converter
+ * maxIdle：最多保留的空闲转换器数
+ */
+EasyMp3ConverterPool::EasyMp3ConverterPool(int destSampleRate, int destChannel, int destBitRate, int maxIdle)
+{
+    m_destRate = destSampleRate;
+    m_destChannel = destChannel;
+    m_destBitRate = destBitRate;
+    m_maxIdle = maxIdle > 0 ? maxIdle : 0;
+    m_resampleProfile = EASY_MP3_RESAMPLE_SINC_BEST;
+    m_encodeProfile = EASY_MP3_ENCODE_DEFAULT;
+    m_created = 0;
+
+    pthread_mutex_init(&m_mutex, NULL);
+    m_idle.reserve(m_maxIdle);
+}
+
+EasyMp3ConverterPool::~EasyMp3ConverterPool()
+{
+    for (size_t i = 0; i < m_idle.size(); i++)
+        delete m_idle[i];
+    m_idle.clear();
+
+    pthread_mutex_destroy(&m_mutex);
+}
+
+/* 预先创建空闲转换器，创建在锁外进行 */
+void EasyMp3ConverterPool::prewarm(int count)
+{
+    while (count-- > 0)
+    {
+        pthread_mutex_lock(&m_mutex);
+        bool full = (int)m_idle.size() >= m_maxIdle;
+        if (!full)
+            m_created++;
+        pthread_mutex_unlock(&m_mutex);
+        if (full)
+            break;
+
+        // 以流式输入创建，不需要文件，取出时再改为实际的输入
+        release(new EasyMp3Converter(m_destRate, m_destChannel, m_destBitRate));
+    }
+}
+
+/* 取出一个空闲转换器，没有时返回NULL */
+EasyMp3Converter *EasyMp3ConverterPool::take()
+{
+    EasyMp3Converter *converter = NULL;
+
+    pthread_mutex_lock(&m_mutex);
+    if (!m_idle.empty())
+    {
+        converter = m_idle.back();
+        m_idle.pop_back();
+    }
+    else
+        m_created++;
+    pthread_mutex_unlock(&m_mutex);
+    return converter;
+}
+
+/* 上一个使用者可能修改过的设置恢复为默认值 */
+void EasyMp3ConverterPool::prepare(EasyMp3Converter *converter)
+{
+    pthread_mutex_lock(&m_mutex);
+    EasyMp3ResampleProfile profile = m_resampleProfile;
+    EasyMp3EncodeProfile encodeProfile = m_encodeProfile;
+    pthread_mutex_unlock(&m_mutex);
+
+    converter->setPipelined(false);
+    converter->setParallelEncode(1);
+    converter->setResampleProfile(profile);
+    converter->setEncodeProfile(encodeProfile);
+}
+
+EasyMp3Converter *EasyMp3ConverterPool::acquire(const std::string &mp3FileName)
+{
+    EasyMp3Converter *converter = take();
+    if (!converter) // 新建的转换器同样经reopen()打开文件，以便判断文件能否打开
+        converter = new EasyMp3Converter(m_destRate, m_destChannel, m_destBitRate);
+
+    bool ok = converter->reopen(mp3FileName);
+    prepare(converter);
+    if (!ok) // 打开失败，转换器仍然可以复用
+    {
+        LOGE("pool acquire failed: %s\n", mp3FileName.c_str());
+        release(converter);
+        return NULL;
+    }
+    return converter;
+}
+
+EasyMp3Converter *EasyMp3ConverterPool::acquireStream()
+{
+    EasyMp3Converter *converter = take();
+
+    if (converter)
+        converter->reopenStream();
+    else
+        converter = new EasyMp3Converter(m_destRate, m_destChannel, m_destBitRate);
+    prepare(converter);
+    return converter;
+}
+
+/* 归还转换器，池满时销毁 */
+void EasyMp3ConverterPool::release(EasyMp3Converter *converter)
+{
+    if (!converter)
+        return;
+
+    pthread_mutex_lock(&m_mutex);
+    bool keep = (int)m_idle.size() < m_maxIdle;
+    if (keep)
+        m_idle.push_back(converter);
+    pthread_mutex_unlock(&m_mutex);
+
+    if (!keep)
+        delete converter;
+}
+
+void EasyMp3ConverterPool::setResampleProfile(EasyMp3ResampleProfile profile)
+{
+    pthread_mutex_lock(&m_mutex);
+    m_resampleProfile = profile;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void EasyMp3ConverterPool::setEncodeProfile(EasyMp3EncodeProfile profile)
+{
+    pthread_mutex_lock(&m_mutex);
+    m_encodeProfile = profile;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+int EasyMp3ConverterPool::idle()
+{
+    pthread_mutex_lock(&m_mutex);
+    int n = (int)m_idle.size();
+    pthread_mutex_unlock(&m_mutex);
+    return n;
+}
+
+unsigned int EasyMp3ConverterPool::created()
+{
+    pthread_mutex_lock(&m_mutex);
+    unsigned int n = m_created;
+    pthread_mutex_unlock(&m_mutex);
+    return n;
+}
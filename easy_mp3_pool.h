@@ -0,0 +1,68 @@
+/*
+ * MP3转换器池
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#ifndef __EASY_MP3_POOL_H__
+#define __EASY_MP3_POOL_H__
+
+#include "easy_mp3_convert.h"
+#include <pthread.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+// 输出参数相同的转换器池，适合服务端按请求转换大量短音频：
+// 用完的转换器归还到池中，下一次取出时只重新打开输入(见EasyMp3Converter::reopen())，
+// 省去每个文件创建解码器、编码器和重采样器的开销；取出和归还可以在不同线程中调用
+class EasyMp3ConverterPool
+{
+public:
+    /* maxIdle：最多保留的空闲转换器数，归还时超出的直接销毁 */
+    EasyMp3ConverterPool(int destSampleRate, int destChannel, int destBitRate, int maxIdle);
+    ~EasyMp3ConverterPool();
+
+    /* 预先创建count个空闲转换器(不超过maxIdle)，之后的请求不再有创建开销 */
+    void prewarm(int count);
+
+    /*
+     * 取出一个转换器重编码mp3FileName，没有空闲的转换器时新建
+     * return：文件打开失败返回NULL
+     */
+    EasyMp3Converter *acquire(const std::string &mp3FileName);
+
+    /* 取出一个流式输入的转换器，见EasyMp3Converter::push()/pull() */
+    EasyMp3Converter *acquireStream();
+
+    /* 归还转换器，之后调用者不能再使用它，原样输出的帧须在归还之前写出 */
+    void release(EasyMp3Converter *converter);
+
+    /* 设置之后取出的转换器的重采样方式 */
+    void setResampleProfile(EasyMp3ResampleProfile profile);
+
+    /* 设置之后取出的转换器的码率控制方式 */
+    void setEncodeProfile(EasyMp3EncodeProfile profile);
+
+    /* 当前空闲的转换器数 */
+    int idle();
+
+    /* 累计新建的转换器数，与取出次数相比即为复用率 */
+    unsigned int created();
+
+private:
+    EasyMp3Converter *take();
+    void prepare(EasyMp3Converter *converter);
+
+private:
+    int m_destRate, m_destChannel, m_destBitRate;
+    int m_maxIdle;
+    EasyMp3ResampleProfile m_resampleProfile;
+    EasyMp3EncodeProfile m_encodeProfile;
+
+    pthread_mutex_t m_mutex;
+    std::vector<EasyMp3Converter *> m_idle; // 后进先出，最近用过的转换器内存更可能还在缓存中
+    unsigned int m_created;
+};
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * 有界单生产者/单消费者队列
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#ifndef __EASY_MP3_QUEUE_H__
+#define __EASY_MP3_QUEUE_H__
+
+#include <pthread.h>
+#include <deque>
+
+// 用于流水线相邻两级之间传递数据：
+// 队列满时Push阻塞(反压，上游不会无限制地领先)，队列空时Pop阻塞，
+// Close()之后唤醒所有等待者，Push失败，Pop取完剩余数据后失败
+template <typename T>
+class EasyBoundedQueue
+{
+public:
+    EasyBoundedQueue()
+    {
+        m_capacity = 1;
+        m_closed = false;
+        pthread_mutex_init(&m_mutex, NULL);
+        pthread_cond_init(&m_notEmpty, NULL);
+        pthread_cond_init(&m_notFull, NULL);
+    }
+
+    ~EasyBoundedQueue()
+    {
+        pthread_cond_destroy(&m_notFull);
+        pthread_cond_destroy(&m_notEmpty);
+        pthread_mutex_destroy(&m_mutex);
+    }
+
+    /* 设置容量并清空队列，须在没有线程使用队列时调用 */
+    void Init(int capacity)
+    {
+        pthread_mutex_lock(&m_mutex);
+        m_capacity = capacity > 0 ? capacity : 1;
+        m_queue.clear();
+        m_closed = false;
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    /* 放入一个元素，队列满时阻塞，队列已关闭返回false */
+    bool Push(const T &item)
+    {
+        pthread_mutex_lock(&m_mutex);
+        while (!m_closed && (int)m_queue.size() >= m_capacity)
+            pthread_cond_wait(&m_notFull, &m_mutex);
+
+        if (m_closed)
+        {
+            pthread_mutex_unlock(&m_mutex);
+            return false;
+        }
+
+        m_queue.push_back(item);
+        pthread_cond_signal(&m_notEmpty);
+        pthread_mutex_unlock(&m_mutex);
+        return true;
+    }
+
+    /* 取出一个元素，队列空时阻塞，队列已关闭且为空返回false */
+    bool Pop(T &item)
+    {
+        pthread_mutex_lock(&m_mutex);
+        while (!m_closed && m_queue.empty())
+            pthread_cond_wait(&m_notEmpty, &m_mutex);
+
+        bool res = TakeFront(item);
+        pthread_mutex_unlock(&m_mutex);
+        return res;
+    }
+
+    /* 不阻塞地取出一个元素，队列空返回false */
+    bool TryPop(T &item)
+    {
+        pthread_mutex_lock(&m_mutex);
+        bool res = TakeFront(item);
+        pthread_mutex_unlock(&m_mutex);
+        return res;
+    }
+
+    /* 关闭队列，唤醒所有阻塞的Push/Pop */
+    void Close()
+    {
+        pthread_mutex_lock(&m_mutex);
+        m_closed = true;
+        pthread_cond_broadcast(&m_notEmpty);
+        pthread_cond_broadcast(&m_notFull);
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+private:
+    bool TakeFront(T &item)
+    {
+        if (m_queue.empty())
+            return false;
+
+        item = m_queue.front();
+        m_queue.pop_front();
+        pthread_cond_signal(&m_notFull);
+        return true;
+    }
+
+private:
+    std::deque<T> m_queue;
+    int m_capacity;
+    bool m_closed;
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_notEmpty;
+    pthread_cond_t m_notFull;
+};
+
+#endif
+
@@ -0,0 +1,368 @@
+/*
+ * MP3输出
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#include "easy_mp3_sink.h"
+#include "print_log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+#define SINK_ALIGN 4096 // 缓冲区按页对齐
+#define ARENA_RESERVE_FRAMES 16 // EasyMp3FrameArena预先保留的帧数，一次转换输出多帧(数据结束时冲刷编码器)时不必扩容
+#define ARENA_FRAME_BYTES 2048 // 大于MPEG-1 Layer III最大帧长1441字节
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/* 写完size字节，处理被信号打断和部分写入 */
+static bool sinkWriteFully(int fd, const unsigned char *data, long size)
+{
+    while (size > 0)
+    {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+static int sinkOpenFile(const std::string &fileName)
+{
+    int fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        LOGE("can not open file: %s\n", fileName.c_str());
+    return fd;
+}
+
+EasyMp3FileSink::EasyMp3FileSink(int bufferSize)
+{
+    m_cap = (bufferSize + SINK_ALIGN - 1) / SINK_ALIGN * SINK_ALIGN;
+    if (m_cap <= 0)
+        m_cap = SINK_ALIGN;
+
+    void *buf = NULL;
+    if (posix_memalign(&buf, SINK_ALIGN, m_cap) != 0)
+        buf = NULL;
+    m_buf = (unsigned char *)buf;
+    m_len = 0;
+    m_fd = -1;
+    m_failed = false;
+    m_syscalls = 0;
+}
+
+EasyMp3FileSink::~EasyMp3FileSink()
+{
+    close();
+    if (m_buf)
+        free(m_buf);
+    m_buf = NULL;
+}
+
+bool EasyMp3FileSink::open(const std::string &fileName)
+{
+    close();
+    m_fd = sinkOpenFile(fileName);
+    m_len = 0;
+    m_failed = m_fd < 0 || !m_buf;
+    m_bytes = 0;
+    m_syscalls = 0;
+    return !m_failed;
+}
+
+bool EasyMp3FileSink::close()
+{
+    if (m_fd < 0)
+        return false;
+
+    bool ok = flush();
+    if (::close(m_fd) != 0)
+        ok = false;
+    m_fd = -1;
+    return ok;
+}
+
+bool EasyMp3FileSink::writeAll(const unsigned char *data, int size)
+{
+    m_syscalls++;
+    if (!sinkWriteFully(m_fd, data, size))
+    {
+        LOGE("write failed: %s\n", strerror(errno));
+        m_failed = true;
+    }
+    return !m_failed;
+}
+
+bool EasyMp3FileSink::write(const unsigned char *data, int size)
+{
+    if (m_failed || m_fd < 0)
+        return false;
+
+    m_bytes += size;
+    while (size > 0)
+    {
+        if (m_len == 0 && size >= m_cap) // 整块直接写，不经过缓冲区
+        {
+            int n = size / m_cap * m_cap;
+            if (!writeAll(data, n))
+                return false;
+            data += n;
+            size -= n;
+            continue;
+        }
+
+        int n = m_cap - m_len;
+        if (n > size)
+            n = size;
+        memcpy(m_buf + m_len, data, n);
+        m_len += n;
+        data += n;
+        size -= n;
+
+        if (m_len == m_cap)
+        {
+            m_len = 0;
+            if (!writeAll(m_buf, m_cap))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool EasyMp3FileSink::flush()
+{
+    if (m_failed || m_fd < 0)
+        return false;
+    if (m_len == 0)
+        return true;
+
+    int len = m_len;
+    m_len = 0;
+    return writeAll(m_buf, len);
+}
+
+EasyMp3WritevSink::EasyMp3WritevSink(int batchBytes)
+{
+    m_batch = batchBytes > SINK_ALIGN ? batchBytes : SINK_ALIGN;
+    m_stage = new unsigned char[m_batch];
+    m_stageLen = 0;
+    m_iov.reserve(IOV_MAX);
+    m_pending = 0;
+    m_fd = -1;
+    m_owned = false;
+    m_failed = false;
+    m_syscalls = 0;
+}
+
+EasyMp3WritevSink::~EasyMp3WritevSink()
+{
+    close();
+    if (m_stage)
+        delete []m_stage;
+    m_stage = NULL;
+}
+
+bool EasyMp3WritevSink::open(const std::string &fileName)
+{
+    close();
+    m_fd = sinkOpenFile(fileName);
+    m_owned = true;
+    m_failed = m_fd < 0;
+    m_bytes = 0;
+    m_syscalls = 0;
+    return !m_failed;
+}
+
+void EasyMp3WritevSink::attach(int fd)
+{
+    close();
+    m_fd = fd;
+    m_owned = false;
+    m_failed = fd < 0;
+    m_bytes = 0;
+    m_syscalls = 0;
+}
+
+bool EasyMp3WritevSink::close()
+{
+    if (m_fd < 0)
+        return false;
+
+    bool ok = flush();
+    if (m_owned && ::close(m_fd) != 0)
+        ok = false;
+    m_fd = -1;
+    return ok;
+}
+
+/* 追加一段，与上一段首尾相接时合并 */
+bool EasyMp3WritevSink::append(const unsigned char *data, int size)
+{
+    if (!m_iov.empty())
+    {
+        struct iovec &last = m_iov.back();
+        if ((const unsigned char *)last.iov_base + last.iov_len == data)
+        {
+            last.iov_len += size;
+            m_pending += size;
+            return m_pending < m_batch || flush();
+        }
+    }
+
+    struct iovec iov;
+    iov.iov_base = (void *)data;
+    iov.iov_len = size;
+    m_iov.push_back(iov);
+    m_pending += size;
+
+    if (m_pending >= m_batch || m_iov.size() >= IOV_MAX)
+        return flush();
+    return true;
+}
+
+bool EasyMp3WritevSink::write(const unsigned char *data, int size)
+{
+    if (m_failed || m_fd < 0)
+        return false;
+
+    m_bytes += size;
+    while (size > 0)
+    {
+        if (m_stageLen == m_batch && !flush()) // 暂存区满了，先输出
+            return false;
+
+        int n = m_batch - m_stageLen;
+        if (n > size)
+            n = size;
+        memcpy(m_stage + m_stageLen, data, n);
+        unsigned char *p = m_stage + m_stageLen;
+        m_stageLen += n;
+        data += n;
+        size -= n;
+
+        if (!append(p, n))
+            return false;
+    }
+    return true;
+}
+
+bool EasyMp3WritevSink::writeStable(const unsigned char *data, int size)
+{
+    if (m_failed || m_fd < 0)
+        return false;
+    if (size <= 0)
+        return true;
+
+    m_bytes += size;
+    return append(data, size);
+}
+
+bool EasyMp3WritevSink::flush()
+{
+    if (m_failed || m_fd < 0)
+        return false;
+
+    size_t first = 0;
+    while (first < m_iov.size())
+    {
+        int count = (int)(m_iov.size() - first);
+        ssize_t n = writev(m_fd, &m_iov[first], count);
+        m_syscalls++;
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            LOGE("writev failed: %s\n", strerror(errno));
+            m_failed = true;
+            break;
+        }
+
+        // 跳过已经写完的段，部分写入的段调整起始位置
+        while (first < m_iov.size() && n >= (ssize_t)m_iov[first].iov_len)
+            n -= m_iov[first++].iov_len;
+        if (n > 0)
+        {
+            m_iov[first].iov_base = (unsigned char *)m_iov[first].iov_base + n;
+            m_iov[first].iov_len -= n;
+        }
+    }
+
+    m_iov.clear();
+    m_pending = 0;
+    m_stageLen = 0;
+    return !m_failed;
+}
+
+bool EasyMp3MemorySink::write(const unsigned char *data, int size)
+{
+    m_out.insert(m_out.end(), data, data + size);
+    m_bytes += size;
+    return true;
+}
+
+EasyMp3FrameArena::EasyMp3FrameArena()
+{
+    m_data.reserve(ARENA_RESERVE_FRAMES * ARENA_FRAME_BYTES);
+    m_offset.reserve(ARENA_RESERVE_FRAMES);
+    m_size.reserve(ARENA_RESERVE_FRAMES);
+    m_first = 0;
+}
+
+bool EasyMp3FrameArena::write(const unsigned char *data, int size)
+{
+    if (m_first > 0 && m_first == m_offset.size()) // 已经全部取走，从头开始
+        clear();
+
+    m_offset.push_back((int)m_data.size());
+    m_size.push_back(size);
+    m_data.insert(m_data.end(), data, data + size);
+    m_bytes += size;
+    return true;
+}
+
+bool EasyMp3FrameArena::front(const unsigned char *&data, int &size)
+{
+    if (m_first >= m_offset.size())
+        return false;
+
+    data = m_data.data() + m_offset[m_first];
+    size = m_size[m_first];
+    return true;
+}
+
+void EasyMp3FrameArena::pop()
+{
+    if (m_first < m_offset.size())
+        m_first++;
+    if (m_first == m_offset.size())
+        clear();
+}
+
+void EasyMp3FrameArena::clear()
+{
+    m_data.clear();
+    m_offset.clear();
+    m_size.clear();
+    m_first = 0;
+}
+
+EasyMp3CallbackSink::EasyMp3CallbackSink(EasyMp3SinkCallback callback, void *arg)
+{
+    m_callback = callback;
+    m_arg = arg;
+}
+
+bool EasyMp3CallbackSink::write(const unsigned char *data, int size)
+{
+    m_bytes += size;
+    return m_callback ? m_callback(data, size, m_arg) : false;
+}
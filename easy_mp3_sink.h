@@ -0,0 +1,158 @@
+/*
+ * MP3输出
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#ifndef __EASY_MP3_SINK_H__
+#define __EASY_MP3_SINK_H__
+
+#include <sys/uio.h>
+#include <string>
+#include <vector>
+
+// 重编码数据的去向：转换器把编码器输出的数据(shine的比特流缓冲区)直接写进来，
+// 不再每帧生成一个vector
+class EasyMp3Sink
+{
+public:
+    EasyMp3Sink() { m_bytes = 0; }
+    virtual ~EasyMp3Sink() {}
+
+    /* 写入数据，返回后data即被调用者复用，需要保留时由sink拷贝 */
+    virtual bool write(const unsigned char *data, int size) = 0;
+
+    /* 写入数据，data在下一次flush()之前保持有效(如文件映射区中原样输出的帧)，可以不拷贝 */
+    virtual bool writeStable(const unsigned char *data, int size) { return write(data, size); }
+
+    /* 输出缓存的数据 */
+    virtual bool flush() { return true; }
+
+    /* 已写入的总字节数 */
+    unsigned long bytes() { return m_bytes; }
+
+protected:
+    unsigned long m_bytes;
+};
+
+// 写文件：数据先拷贝到按页对齐的大缓冲区，攒满后一次write()
+class EasyMp3FileSink : public EasyMp3Sink
+{
+public:
+    /* bufferSize：缓冲区大小，向上取整到4096的倍数 */
+    EasyMp3FileSink(int bufferSize);
+    ~EasyMp3FileSink();
+
+    bool open(const std::string &fileName);
+    bool close(); // 输出剩余数据并关闭文件
+
+    bool write(const unsigned char *data, int size);
+    bool flush();
+
+    /* 已经调用write()的次数 */
+    unsigned int syscalls() { return m_syscalls; }
+
+private:
+    bool writeAll(const unsigned char *data, int size);
+
+private:
+    int m_fd;
+    unsigned char *m_buf; // 按页对齐
+    int m_cap, m_len;
+    bool m_failed; // 写文件出错，之后的数据都丢弃
+    unsigned int m_syscalls;
+};
+
+// 写文件描述符(文件或者socket)：攒够batchBytes字节或者IOV_MAX段之后一次writev()
+// writeStable()的数据不拷贝，相邻的合并成一段；write()的数据拷贝到暂存区
+// 注意：writeStable()的数据须在flush()之前保持有效，如原样输出的帧须在转换器销毁之前flush()
+class EasyMp3WritevSink : public EasyMp3Sink
+{
+public:
+    EasyMp3WritevSink(int batchBytes);
+    ~EasyMp3WritevSink();
+
+    bool open(const std::string &fileName);
+    void attach(int fd); // 使用已经打开的fd，不负责关闭
+    bool close(); // 输出剩余数据，open()打开的文件同时关闭
+
+    bool write(const unsigned char *data, int size);
+    bool writeStable(const unsigned char *data, int size);
+    bool flush();
+
+    /* 已经调用writev()的次数 */
+    unsigned int syscalls() { return m_syscalls; }
+
+private:
+    bool append(const unsigned char *data, int size);
+
+private:
+    int m_fd;
+    bool m_owned; // m_fd是否由open()打开
+    int m_batch; // 攒够多少字节输出一次
+    std::vector<struct iovec> m_iov;
+    unsigned char *m_stage; // write()的数据暂存区，大小为m_batch
+    int m_stageLen;
+    long m_pending; // m_iov中的总字节数
+    bool m_failed;
+    unsigned int m_syscalls;
+};
+
+// 写内存：追加到调用者提供的vector
+class EasyMp3MemorySink : public EasyMp3Sink
+{
+public:
+    EasyMp3MemorySink(std::vector<unsigned char> &out) : m_out(out) {}
+
+    bool write(const unsigned char *data, int size);
+
+private:
+    std::vector<unsigned char> &m_out;
+};
+
+// 按帧缓存在一块连续内存中：每次write()作为一帧，记录偏移和大小，
+// 取完之后内存重复使用，稳定运行时不再分配内存
+class EasyMp3FrameArena : public EasyMp3Sink
+{
+public:
+    EasyMp3FrameArena();
+
+    bool write(const unsigned char *data, int size);
+
+    /* 还未取走的帧数 */
+    int count() { return (int)(m_offset.size() - m_first); }
+
+    /* 最早的一帧，在下一次write()之前有效，没有时返回false */
+    bool front(const unsigned char *&data, int &size);
+
+    /* 丢弃最早的一帧 */
+    void pop();
+
+    /* 丢弃全部帧，保留内存 */
+    void clear();
+
+private:
+    std::vector<unsigned char> m_data;
+    std::vector<int> m_offset, m_size;
+    size_t m_first; // 最早一帧的序号
+};
+
+/*
+ * 回调输出，每次write()调用一次
+ * return：返回false表示出错，转换器会停止输出
+ */
+typedef bool (*EasyMp3SinkCallback)(const unsigned char *data, int size, void *arg);
+
+class EasyMp3CallbackSink : public EasyMp3Sink
+{
+public:
+    EasyMp3CallbackSink(EasyMp3SinkCallback callback, void *arg);
+
+    bool write(const unsigned char *data, int size);
+
+private:
+    EasyMp3SinkCallback m_callback;
+    void *m_arg;
+};
+
+#endif
@@ -0,0 +1,261 @@
+/*
+ * MP3帧级拼接
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#include "easy_mp3_splice.h"
+#include "easy_mp3_frame_index.h"
+#include "mp3_file_parse.h"
+#include "print_log.h"
+#include <string.h>
+
+#define XING_FLAGS 0x0f // 帧数、字节数、TOC表、质量都有
+
+// 按大端写入4字节
+static void spliceWriteBE32(unsigned char *p, unsigned int v)
+{
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+/*
+ * Layer III帧的main_data_begin：本帧主数据在前面帧中开始的位置(往前的字节数)
+ * MPEG-1为9位，MPEG-2/2.5为8位，紧跟在帧头(和CRC)之后
+ */
+static int spliceMainDataBegin(const unsigned char *frame, const MpegAudioFrameInfo &info)
+{
+    const unsigned char *side = frame + 4 + (info.protection ? 2 : 0);
+    if (info.mpegVersion == 10)
+        return (side[0] << 1) | (side[1] >> 7);
+    return side[0];
+}
+
+EasyMp3Splicer::EasyMp3Splicer()
+{
+    m_file = NULL;
+    m_written = 0;
+    m_dropped = 0;
+    m_failed = false;
+    memset(m_header, 0, sizeof(m_header));
+    m_version = m_samplerate = m_channelMode = m_sideInfoSize = m_samplesPerFrame = 0;
+    m_bitrate = 0;
+    m_vbr = false;
+    m_xingSize = 0;
+}
+
+EasyMp3Splicer::~EasyMp3Splicer()
+{
+    close();
+}
+
+bool EasyMp3Splicer::open(const std::string &fileName)
+{
+    close();
+
+    m_file = fopen(fileName.c_str(), "wb");
+    if (!m_file)
+    {
+        LOGE("can not open file: %s\n", fileName.c_str());
+        return false;
+    }
+
+    m_written = 0;
+    m_offsets.clear();
+    m_dropped = 0;
+    m_failed = false;
+    m_vbr = false;
+    m_xingSize = 0;
+    return true;
+}
+
+/* 与第一帧音频帧的格式是否相同，比特率可以不同 */
+bool EasyMp3Splicer::compatible(const MpegAudioFrameInfo &info)
+{
+    return info.layer == 3 && info.mpegVersion == m_version && info.samplerate == m_samplerate &&
+        (info.channelMode == 1) == (m_channelMode == 1);
+}
+
+/* 写入data中[start, end)的连续帧 */
+bool EasyMp3Splicer::flush(const unsigned char *data, long start, long end)
+{
+    if (end <= start)
+        return true;
+
+    if (fwrite(data + start, 1, end - start, m_file) != (size_t)(end - start))
+    {
+        LOGE("write failed\n");
+        m_failed = true;
+        return false;
+    }
+    m_written += end - start;
+    return true;
+}
+
+/*
+ * 追加一段完整的MP3数据
+ * 连续保留的帧在数据中本来就是相邻的，合并成一次fwrite
+ */
+bool EasyMp3Splicer::append(const unsigned char *data, long size)
+{
+    MpegAudioFrameInfo info;
+    long pos = 0, framePos = 0;
+    long runStart = 0, runEnd = 0; // 待写入的连续帧
+    int reservoir = 0; // 本段已写入的帧中可以被后面帧引用的主数据字节数
+    bool firstFrame = true, checked = false;
+
+    if (!m_file || m_failed)
+        return false;
+
+    while (findNextMpegAudioFrame(data, size, pos, firstFrame, framePos, &info))
+    {
+        bool tagFrame = firstFrame && info.bitrateType; // XING/INFO/VBRI帧不含音频数据
+        firstFrame = false;
+        if (tagFrame)
+            continue;
+
+        if (!checked) // 本段第一帧音频帧决定能否拼接
+        {
+            if (m_xingSize == 0)
+            {
+                if (info.layer != 3)
+                {
+                    LOGE("only layer III can be spliced, layer %d\n", info.layer);
+                    return false;
+                }
+
+                memcpy(m_header, data + framePos, sizeof(m_header));
+                m_version = info.mpegVersion;
+                m_samplerate = info.samplerate;
+                m_channelMode = info.channelMode;
+                m_sideInfoSize = info.sideInfoSize;
+                m_samplesPerFrame = info.samplesPerFrame;
+                m_bitrate = info.bitrate;
+
+                // 文件头预留XING帧的位置，关闭时回写
+                std::vector<unsigned char> xing;
+                m_xingSize = buildXingFrame(xing);
+                if (!flush(xing.data(), 0, m_xingSize))
+                    return false;
+            }
+            else if (!compatible(info))
+            {
+                LOGE("can not splice: %d Hz layer %d, expect %d Hz layer 3\n", info.samplerate, info.layer, m_samplerate);
+                return false;
+            }
+            checked = true;
+        }
+
+        // 格式不同的帧(数据损坏)，以及引用了本段之前数据的帧，拼接后无法解码
+        if (!compatible(info) || spliceMainDataBegin(data + framePos, info) > reservoir)
+        {
+            if (!flush(data, runStart, runEnd))
+                return false;
+            runStart = runEnd = 0;
+            reservoir = 0; // 后面的帧可能引用被丢弃帧的数据
+            m_dropped++;
+            continue;
+        }
+        reservoir += info.frameSize - 4 - (info.protection ? 2 : 0) - info.sideInfoSize;
+
+        if (framePos != runEnd || runEnd == 0) // 与上一帧不相邻，重新开始一段
+        {
+            if (!flush(data, runStart, runEnd))
+                return false;
+            runStart = framePos;
+        }
+        runEnd = framePos + info.frameSize;
+
+        m_offsets.push_back(m_written + (framePos - runStart));
+        if (info.bitrate != m_bitrate)
+            m_vbr = true;
+    }
+
+    if (!checked)
+    {
+        LOGE("no audio frame to splice\n");
+        return false;
+    }
+    return flush(data, runStart, runEnd);
+}
+
+/* 追加一个MP3文件，直接从文件映射区写入 */
+bool EasyMp3Splicer::appendFile(const std::string &fileName)
+{
+    Mp3FileParse parser(fileName);
+    if (!parser.GetData())
+        return false;
+    return append(parser.GetData(), parser.GetSize());
+}
+
+unsigned int EasyMp3Splicer::duration()
+{
+    if (m_samplerate <= 0)
+        return 0;
+    return (unsigned int)((double)m_offsets.size() * m_samplesPerFrame * 1000 / m_samplerate);
+}
+
+/*
+ * 生成XING帧：格式与第一帧相同，MPEG-1用128kbps，MPEG-2/2.5用64kbps，
+ * 保证帧足够放下XING头，解码器把它当作一帧静音
+ * return：帧大小
+ */
+int EasyMp3Splicer::buildXingFrame(std::vector<unsigned char> &frame)
+{
+    int kbps = m_version == 10 ? 128 : 64;
+    int bitrateIndex = m_version == 10 ? 9 : 8;
+    int size = (m_version == 10 ? 144 : 72) * kbps * 1000 / m_samplerate;
+    unsigned int total = (unsigned int)m_written;
+    unsigned int count = (unsigned int)m_offsets.size();
+
+    frame.assign(size, 0);
+    frame[0] = 0xff;
+    frame[1] = m_header[1] | 0x01; // 不带CRC
+    frame[2] = (unsigned char)((bitrateIndex << 4) | (m_header[2] & 0x0c)); // 采样率不变，不填充
+    frame[3] = m_header[3] & 0xcf; // 清除mode extension
+
+    unsigned char *p = frame.data() + 4 + m_sideInfoSize;
+    memcpy(p, m_vbr ? "Xing" : "Info", 4);
+    spliceWriteBE32(p + 4, XING_FLAGS);
+    spliceWriteBE32(p + 8, count);
+    spliceWriteBE32(p + 12, total);
+
+    // TOC：第i项为时间i%处的帧在文件中的偏移，单位为总字节数的1/256
+    unsigned char *toc = p + 16;
+    for (int i = 0; i < 100 && count > 0 && total > 0; i++)
+    {
+        unsigned int n = (unsigned int)((unsigned long)i * count / 100);
+        unsigned long v = (unsigned long)m_offsets[n] * 256 / total;
+        toc[i] = (unsigned char)(v > 255 ? 255 : v);
+    }
+    spliceWriteBE32(p + 116, 0); // 质量，未知
+    return size;
+}
+
+/* 回写XING帧并关闭输出文件 */
+bool EasyMp3Splicer::close()
+{
+    if (!m_file)
+        return false;
+
+    bool ok = !m_failed;
+    if (ok && m_xingSize > 0)
+    {
+        std::vector<unsigned char> xing;
+        buildXingFrame(xing);
+        ok = fseek(m_file, 0, SEEK_SET) == 0 && fwrite(xing.data(), 1, xing.size(), m_file) == xing.size();
+        if (!ok)
+            LOGE("write xing header failed\n");
+    }
+
+    if (fclose(m_file) != 0)
+        ok = false;
+    m_file = NULL;
+
+    if (m_xingSize > 0)
+        LOG("splice done: %u frames, dropped %u, %u bytes, %u ms, %s\n", frames(), m_dropped,
+            (unsigned int)m_written, duration(), m_vbr ? "vbr" : "cbr");
+    return ok;
+}
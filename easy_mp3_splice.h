@@ -0,0 +1,65 @@
+/*
+ * MP3帧级拼接
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#ifndef __EASY_MP3_SPLICE_H__
+#define __EASY_MP3_SPLICE_H__
+
+#include "easy_mp3_parse_frame.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// 不解码不编码，按帧把多段格式相同(MPEG版本、采样率、单/双声道一致)的Layer III数据拼接成一个文件：
+// 1、每段开头的ID3标签和XING/INFO/VBRI帧被丢弃
+// 2、main_data_begin引用了本段之前数据(比特池)的帧，接在上一段后面无法正确解码，也被丢弃，
+//    通常只有从文件中间截取的片段才会出现
+// 3、文件头写入新的XING/INFO帧，记录总帧数、总字节数和TOC表
+class EasyMp3Splicer
+{
+public:
+    EasyMp3Splicer();
+    ~EasyMp3Splicer();
+
+    /* 创建输出文件 */
+    bool open(const std::string &fileName);
+
+    /*
+     * 追加一段完整的MP3数据，一段内的帧按原样连续写入
+     * return：没有音频帧或者格式与已写入的数据不一致时返回false，此时不写入任何数据
+     */
+    bool append(const unsigned char *data, long size);
+
+    /* 追加一个MP3文件，见append() */
+    bool appendFile(const std::string &fileName);
+
+    /* 回写XING帧并关闭输出文件 */
+    bool close();
+
+    unsigned int frames() { return (unsigned int)m_offsets.size(); } // 已写入的音频帧数
+    unsigned int droppedFrames() { return m_dropped; } // 丢弃的帧数(不含XING/INFO/VBRI帧)
+    unsigned int duration(); // 已写入的时长，单位ms
+
+private:
+    bool compatible(const MpegAudioFrameInfo &info);
+    bool flush(const unsigned char *data, long start, long end);
+    int buildXingFrame(std::vector<unsigned char> &frame);
+
+private:
+    FILE *m_file;
+    long m_written; // 已写入的字节数，包括文件头预留的XING帧
+    std::vector<long> m_offsets; // 每个音频帧在输出文件中的偏移，用于生成TOC表
+    unsigned int m_dropped;
+    bool m_failed; // 写文件出错
+
+    // 第一帧音频帧的格式，后面追加的数据须与之相同
+    unsigned char m_header[4]; // 第一帧的帧头
+    int m_version, m_samplerate, m_channelMode, m_sideInfoSize, m_samplesPerFrame;
+    int m_bitrate; // 第一帧的比特率，后面有不同时写XING，否则写INFO
+    bool m_vbr;
+    int m_xingSize; // XING帧大小，0表示还没有写入音频帧
+};
+
+#endif
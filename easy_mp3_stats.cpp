@@ -0,0 +1,215 @@
+/*
+ * 重编码各阶段耗时统计
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#include "easy_mp3_stats.h"
+#include "print_log.h"
+#include <pthread.h>
+#include <errno.h>
+#include <vector>
+
+std::atomic<bool> g_easy_mp3_stats_enabled(false);
+
+static const char *stageNames[EASY_MP3_STAGE_NUM] = { "parse", "decode", "resample", "encode", "iteration" };
+
+// 每个线程一份计数器，只有本线程写，读取方(EasyMp3StatsGet)可能在其他线程，所以用原子变量
+typedef struct EasyMp3ThreadStats
+{
+    std::atomic<unsigned long long> calls[EASY_MP3_STAGE_NUM];
+    std::atomic<unsigned long long> ns[EASY_MP3_STAGE_NUM];
+}EasyMp3ThreadStats;
+
+// 线程注册/退出和读取时加锁，计时点不加锁
+static pthread_mutex_t g_statsMutex = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<EasyMp3ThreadStats *> g_statsThreads; // 正在运行的线程
+static EasyMp3Stats g_statsRetired; // 已经退出的线程的累计值
+
+// 线程退出时把计数器并入g_statsRetired
+class EasyMp3StatsSlot
+{
+public:
+    EasyMp3StatsSlot() : m_stats(NULL) {}
+    ~EasyMp3StatsSlot();
+
+    EasyMp3ThreadStats *get()
+    {
+        if (!m_stats)
+            attach();
+        return m_stats;
+    }
+
+private:
+    void attach();
+
+private:
+    EasyMp3ThreadStats *m_stats;
+};
+
+static thread_local EasyMp3StatsSlot t_statsSlot;
+
+/* 本线程第一次计时时注册 */
+void EasyMp3StatsSlot::attach()
+{
+    m_stats = new EasyMp3ThreadStats();
+    for (int i = 0; i < EASY_MP3_STAGE_NUM; i++)
+    {
+        m_stats->calls[i].store(0, std::memory_order_relaxed);
+        m_stats->ns[i].store(0, std::memory_order_relaxed);
+    }
+
+    pthread_mutex_lock(&g_statsMutex);
+    g_statsThreads.push_back(m_stats);
+    pthread_mutex_unlock(&g_statsMutex);
+}
+
+EasyMp3StatsSlot::~EasyMp3StatsSlot()
+{
+    if (!m_stats)
+        return;
+
+    pthread_mutex_lock(&g_statsMutex);
+    for (int i = 0; i < EASY_MP3_STAGE_NUM; i++)
+    {
+        g_statsRetired.calls[i] += m_stats->calls[i].load(std::memory_order_relaxed);
+        g_statsRetired.ns[i] += m_stats->ns[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < g_statsThreads.size(); i++)
+    {
+        if (g_statsThreads[i] == m_stats)
+        {
+            g_statsThreads.erase(g_statsThreads.begin() + i);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_statsMutex);
+
+    delete m_stats;
+    m_stats = NULL;
+}
+
+void EasyMp3StatsEnable(bool enable)
+{
+    g_easy_mp3_stats_enabled.store(enable, std::memory_order_relaxed);
+}
+
+/* 只有本线程写，读-改-写不需要原子指令 */
+void EasyMp3StatsAdd(int stage, unsigned long long ns)
+{
+    if (stage < 0 || stage >= EASY_MP3_STAGE_NUM)
+        return;
+
+    EasyMp3ThreadStats *stats = t_statsSlot.get();
+    stats->calls[stage].store(stats->calls[stage].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    stats->ns[stage].store(stats->ns[stage].load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+}
+
+void EasyMp3StatsGet(EasyMp3Stats &stats)
+{
+    pthread_mutex_lock(&g_statsMutex);
+    stats = g_statsRetired;
+    for (size_t t = 0; t < g_statsThreads.size(); t++)
+    {
+        for (int i = 0; i < EASY_MP3_STAGE_NUM; i++)
+        {
+            stats.calls[i] += g_statsThreads[t]->calls[i].load(std::memory_order_relaxed);
+            stats.ns[i] += g_statsThreads[t]->ns[i].load(std::memory_order_relaxed);
+        }
+    }
+    pthread_mutex_unlock(&g_statsMutex);
+}
+
+const char *EasyMp3StageName(int stage)
+{
+    if (stage < 0 || stage >= EASY_MP3_STAGE_NUM)
+        return "unknown";
+    return stageNames[stage];
+}
+
+/* 每个阶段一行：调用次数、总耗时和平均每次的耗时 */
+void EasyMp3StatsPrint(const char *title, const EasyMp3Stats &stats, const EasyMp3Stats *since)
+{
+    LOG("%s\n", title);
+    for (int i = 0; i < EASY_MP3_STAGE_NUM; i++)
+    {
+        unsigned long long calls = stats.calls[i] - (since ? since->calls[i] : 0);
+        unsigned long long ns = stats.ns[i] - (since ? since->ns[i] : 0);
+        LOG("  %-10s calls %10llu  total %10.1f ms  avg %8.2f us\n", stageNames[i], calls, ns / 1e6,
+            calls > 0 ? ns / 1e3 / calls : 0.0);
+    }
+}
+
+// 周期输出
+static pthread_t g_dumpThread;
+static bool g_dumpRunning = false;
+static bool g_dumpStop = false;
+static int g_dumpInterval = 0;
+static pthread_cond_t g_dumpCond = PTHREAD_COND_INITIALIZER;
+
+static void *statsDumpThread(void *)
+{
+    EasyMp3Stats last, now;
+    EasyMp3StatsGet(last);
+
+    pthread_mutex_lock(&g_statsMutex);
+    while (!g_dumpStop)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += g_dumpInterval / 1000;
+        ts.tv_nsec += (long)(g_dumpInterval % 1000) * 1000000;
+        if (ts.tv_nsec >= 1000000000)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+
+        int ret = 0;
+        while (!g_dumpStop && ret != ETIMEDOUT)
+            ret = pthread_cond_timedwait(&g_dumpCond, &g_statsMutex, &ts);
+        if (g_dumpStop)
+            break;
+
+        pthread_mutex_unlock(&g_statsMutex); // 取数据和输出时不能持有锁
+        EasyMp3StatsGet(now);
+        EasyMp3StatsPrint("stage stats (last interval):", now, &last);
+        last = now;
+        pthread_mutex_lock(&g_statsMutex);
+    }
+    pthread_mutex_unlock(&g_statsMutex);
+    return NULL;
+}
+
+bool EasyMp3StatsStartDump(int intervalMs)
+{
+    if (intervalMs <= 0)
+        return false;
+
+    EasyMp3StatsStopDump();
+    EasyMp3StatsEnable(true);
+
+    g_dumpStop = false;
+    g_dumpInterval = intervalMs;
+    if (pthread_create(&g_dumpThread, NULL, statsDumpThread, NULL) != 0)
+    {
+        LOGE("can not create stats dump thread\n");
+        return false;
+    }
+    g_dumpRunning = true;
+    return true;
+}
+
+void EasyMp3StatsStopDump()
+{
+    if (!g_dumpRunning)
+        return;
+
+    pthread_mutex_lock(&g_statsMutex);
+    g_dumpStop = true;
+    pthread_cond_signal(&g_dumpCond);
+    pthread_mutex_unlock(&g_statsMutex);
+
+    pthread_join(g_dumpThread, NULL);
+    g_dumpRunning = false;
+}
@@ -0,0 +1,89 @@
+/*
+ * 重编码各阶段耗时统计
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#ifndef __EASY_MP3_STATS_H__
+#define __EASY_MP3_STATS_H__
+
+#include <atomic>
+#include <time.h>
+
+// 统计的阶段，ITERATION为shine的量化迭代，包含在ENCODE之内
+enum EasyMp3Stage
+{
+    EASY_MP3_STAGE_PARSE = 0, // Mp3FileParse::GetNextFrame()
+    EASY_MP3_STAGE_DECODE, // EasyMp3DecoderDecode()
+    EASY_MP3_STAGE_RESAMPLE, // CResampleEx/CResamplePoly::resample_run()
+    EASY_MP3_STAGE_ENCODE, // EasyMp3Encoder::encode()
+    EASY_MP3_STAGE_ITERATION, // shine_iteration_loop()
+    EASY_MP3_STAGE_NUM,
+};
+
+// 全部线程累计的统计数据
+typedef struct EasyMp3Stats
+{
+    unsigned long long calls[EASY_MP3_STAGE_NUM]; // 调用次数
+    unsigned long long ns[EASY_MP3_STAGE_NUM]; // 累计耗时，单位ns
+}EasyMp3Stats;
+
+extern std::atomic<bool> g_easy_mp3_stats_enabled;
+
+/* 开启/关闭统计，默认关闭，关闭时每个计时点只有一次判断 */
+void EasyMp3StatsEnable(bool enable);
+
+/* 取当前的累计值(包括已经退出的线程)，可以在任意线程中调用 */
+void EasyMp3StatsGet(EasyMp3Stats &stats);
+
+/* 阶段名称，如"decode" */
+const char *EasyMp3StageName(int stage);
+
+/*
+ * 通过print_log输出统计数据
+ * since：不为NULL时输出与since之间的差值，即这段时间内的耗时
+ */
+void EasyMp3StatsPrint(const char *title, const EasyMp3Stats &stats, const EasyMp3Stats *since);
+
+/* 启动后台线程，每intervalMs毫秒输出一次这段时间内的统计，同时开启统计 */
+bool EasyMp3StatsStartDump(int intervalMs);
+void EasyMp3StatsStopDump();
+
+/* 累加到本线程的计数器，不加锁 */
+void EasyMp3StatsAdd(int stage, unsigned long long ns);
+
+static inline unsigned long long EasyMp3StatsNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* 阶段开始计时，统计关闭时返回0 */
+static inline unsigned long long EasyMp3StageBegin(void)
+{
+    if (!g_easy_mp3_stats_enabled.load(std::memory_order_relaxed))
+        return 0;
+    return EasyMp3StatsNow();
+}
+
+/* 阶段结束，start为EasyMp3StageBegin()的返回值 */
+static inline void EasyMp3StageEnd(int stage, unsigned long long start)
+{
+    if (start)
+        EasyMp3StatsAdd(stage, EasyMp3StatsNow() - start);
+}
+
+// 作用域计时：构造时开始，析构时结束，适合有多个返回点的函数
+class EasyMp3StageScope
+{
+public:
+    EasyMp3StageScope(int stage) : m_stage(stage), m_start(EasyMp3StageBegin()) {}
+    ~EasyMp3StageScope() { EasyMp3StageEnd(m_stage, m_start); }
+
+private:
+    int m_stage;
+    unsigned long long m_start;
+};
+
+#endif
@@ -1,6 +1,8 @@
 #include "easy_mp3_convert.h"
+#include "easy_mp3_batch.h"
+#include "easy_mp3_splice.h"
+#include "easy_mp3_stats.h"
 #include <time.h>
-#include <fstream>
 using namespace std;
 
 #define DEST_SAMPLERATE 44100
@@ -16,41 +18,160 @@ unsigned long GetTickCount(void)
 }
 
 
+// -r 参数可选的重采样方式
+static const struct
+{
+    const char *name;
+    EasyMp3ResampleProfile profile;
+} resampleProfiles[] = {
+    { "best", EASY_MP3_RESAMPLE_SINC_BEST },
+    { "medium", EASY_MP3_RESAMPLE_SINC_MEDIUM },
+    { "fastest", EASY_MP3_RESAMPLE_SINC_FASTEST },
+    { "linear", EASY_MP3_RESAMPLE_LINEAR },
+    { "poly-fast", EASY_MP3_RESAMPLE_POLY_FAST },
+    { "poly-medium", EASY_MP3_RESAMPLE_POLY_MEDIUM },
+    { "poly-high", EASY_MP3_RESAMPLE_POLY_HIGH },
+};
+
+// 按输入顺序把每个文件的转换结果拼接写入同一个输出文件
+static void writeResult(int index, const EasyMp3BatchResult &result, void *arg)
+{
+    EasyMp3FileSink *outfile = (EasyMp3FileSink *)arg;
+    if (!outfile->write(result.data.data(), result.data.size()))
+        LOG("write file %d (%s) failed\n", index, result.fileName.c_str());
+}
+
+// 按输入顺序逐帧拼接，去掉每个文件自带的XING帧，最后写入新的XING帧
+static void spliceResult(int index, const EasyMp3BatchResult &result, void *arg)
+{
+    EasyMp3Splicer *splicer = (EasyMp3Splicer *)arg;
+    if (!splicer->append(result.data.data(), result.data.size()))
+        LOG("splice file %d (%s) failed\n", index, result.fileName.c_str());
+}
+
 int main(int argc, char **argv)
 {
-    run_init_log(4, 0);
+    run_init_log_async(4, 0);
     if (argc < 2)
     {
-        LOG("usage: %s <mp3-file1> [<mp3-file2> ...]\n", argv[0]);
+        LOG("usage: %s [-j threads] [-p] [-e encode_threads] [-r best|medium|fastest|linear|poly-fast|poly-medium|poly-high] [-q default|fast] [-s] [-m stats_interval_ms] <mp3-file1> [<mp3-file2> ...]\n", argv[0]);
         return -1;
     }
 
-    char filename[64] = {0};
-	std::vector<unsigned char> frame;
+    int threads = 0; // 默认使用全部CPU核
+    bool pipelined = false; // 单个文件内解码/重采样/编码流水线
+    int encodeThreads = 1; // 单个文件的编码线程数
+    EasyMp3ResampleProfile resampleProfile = EASY_MP3_RESAMPLE_SINC_BEST;
+    EasyMp3EncodeProfile encodeProfile = EASY_MP3_ENCODE_DEFAULT;
+    bool splice = false; // 按帧拼接输出，已是目标格式的文件不转码
+    int statsInterval = 0; // 各阶段耗时统计的输出间隔，0表示不统计
+    int first = 1;
+    while (first < argc - 1 && argv[first][0] == '-')
+    {
+        if (strcmp(argv[first], "-j") == 0 && first + 2 < argc)
+        {
+            threads = atoi(argv[first + 1]);
+            first += 2;
+        }
+        else if (strcmp(argv[first], "-e") == 0 && first + 2 < argc)
+        {
+            encodeThreads = atoi(argv[first + 1]);
+            first += 2;
+        }
+        else if (strcmp(argv[first], "-r") == 0 && first + 2 < argc)
+        {
+            size_t i = 0;
+            for (; i < sizeof(resampleProfiles) / sizeof(resampleProfiles[0]); i++)
+            {
+                if (strcmp(argv[first + 1], resampleProfiles[i].name) == 0)
+                    break;
+            }
+            if (i == sizeof(resampleProfiles) / sizeof(resampleProfiles[0]))
+            {
+                LOG("unknown resample profile: %s\n", argv[first + 1]);
+                return -1;
+            }
+            resampleProfile = resampleProfiles[i].profile;
+            first += 2;
+        }
+        else if (strcmp(argv[first], "-q") == 0 && first + 2 < argc)
+        {
+            if (strcmp(argv[first + 1], "default") == 0)
+                encodeProfile = EASY_MP3_ENCODE_DEFAULT;
+            else if (strcmp(argv[first + 1], "fast") == 0)
+                encodeProfile = EASY_MP3_ENCODE_FAST;
+            else
+            {
+                LOG("unknown encode profile: %s\n", argv[first + 1]);
+                return -1;
+            }
+            first += 2;
+        }
+        else if (strcmp(argv[first], "-m") == 0 && first + 2 < argc)
+        {
+            statsInterval = atoi(argv[first + 1]);
+            first += 2;
+        }
+        else if (strcmp(argv[first], "-p") == 0)
+        {
+            pipelined = true;
+            first++;
+        }
+        else if (strcmp(argv[first], "-s") == 0)
+        {
+            splice = true;
+            first++;
+        }
+        else
+            break;
+    }
 
+    char filename[64] = {0};
     snprintf(filename, sizeof(filename), "%d_%d_16.mp3", DEST_SAMPLERATE, DEST_CHANNELS);
-    std::ofstream outfile(filename, std::ios::binary);
+    EasyMp3FileSink outfile(512 * 1024); // 攒够512KB写一次
+    EasyMp3Splicer splicer;
+    bool opened = false;
+    if (splice)
+        opened = splicer.open(filename);
+    else
+        opened = outfile.open(filename);
 
-    if (!outfile.is_open())
+    if (!opened)
     {
         LOG("can not open file: %s\n", filename);
         return -1;
     }
 
-    for (int i=0; i<argc-1; i++)
+    std::vector<std::string> files(argv + first, argv + argc);
+    EasyMp3BatchConverter batch(DEST_SAMPLERATE, DEST_CHANNELS, DEST_BITRATE, threads);
+    batch.setPipelined(pipelined);
+    batch.setParallelEncode(encodeThreads);
+    batch.setResampleProfile(resampleProfile);
+    batch.setEncodeProfile(encodeProfile);
+
+    if (statsInterval > 0)
+        EasyMp3StatsStartDump(statsInterval);
+
+    unsigned long stick = GetTickCount();
+    if (splice)
+    {
+        batch.run(files, spliceResult, &splicer);
+        splicer.close();
+    }
+    else
     {
-        EasyMp3Converter0 *converter = new EasyMp3Converter0(DEST_SAMPLERATE, DEST_CHANNELS, DEST_BITRATE);
-		converter->open(argv[i+1]);
+        batch.run(files, writeResult, &outfile);
+        outfile.close();
+    }
+    LOG("converted %d files with %d threads cost time: %lu ms, realtime factor: %.1fx\n",
+        (int)files.size(), batch.threads(), GetTickCount()-stick, batch.realtimeFactor());
 
-        LOG("converting %d --> %s\n", i+1, argv[i+1]);
-        unsigned long stick = GetTickCount();
-        while (converter->convert(frame))
-        {
-			LOG("frame: %d, sz: %d\n", frame.size(), frame.size());
-            outfile.write((const char *)frame.data(), frame.size());
-        }
-        LOG("converted %s cost time: %lu ms\n", argv[i+1], GetTickCount()-stick);
-        delete converter;
+    if (statsInterval > 0)
+    {
+        EasyMp3StatsStopDump();
+        EasyMp3Stats stats;
+        EasyMp3StatsGet(stats);
+        EasyMp3StatsPrint("stage stats (total):", stats, NULL);
     }
 
     return 0;
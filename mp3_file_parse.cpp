@@ -1,24 +1,83 @@
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "easy_mp3_parse_frame.h"
 #include "mp3_file_parse.h"
 #include "print_log.h"
+#include "easy_mp3_stats.h"
 
 
 Mp3FileParse::Mp3FileParse(const std::string &filename)
 {
-    FILE *fp = fopen(filename.c_str(), "rb");
-    m_file = fp;
+    m_data = NULL;
+    m_size = 0;
+    m_mapped = false;
     m_nextPos = 0;
+    m_firstFrame = true;
+    m_lastPos = 0;
+    m_lastFirstFrame = true;
+    m_indexed = false;
+    m_probed = false;
+    m_firstPos = -1;
+    m_audioStart = 0;
+    memset(&m_firstInfo, 0, sizeof(m_firstInfo));
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        LOG("can not open file: %s\n", filename.c_str());
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return;
+    }
+
+    void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED)
+    {
+        madvise(addr, st.st_size, MADV_SEQUENTIAL); // 顺序读取，让内核提前预读
+        m_data = (const unsigned char *)addr;
+        m_size = st.st_size;
+        m_mapped = true;
+    }
+    else // 映射失败则一次性读入内存
+    {
+        unsigned char *buf = new unsigned char[st.st_size];
+        long total = 0;
+        while (total < st.st_size)
+        {
+            ssize_t n = read(fd, buf + total, st.st_size - total);
+            if (n <= 0)
+                break;
+            total += n;
+        }
+        m_data = buf;
+        m_size = total;
+    }
+
+    close(fd);
 }
 
 Mp3FileParse::~Mp3FileParse()
 {
-    FILE *fp = (FILE *)m_file;
-    if (fp)
-        fclose(fp);
-    m_file = NULL;
+    if (m_data)
+    {
+        if (m_mapped)
+            munmap((void *)m_data, m_size);
+        else
+            delete []m_data;
+    }
+    m_data = NULL;
+    m_size = 0;
 }
 
 /*
@@ -27,75 +86,197 @@ Mp3FileParse::~Mp3FileParse()
  */
 bool Mp3FileParse::GetNextFrame(std::vector<unsigned char> &mp3data)
 {
-    FILE *mp3File = (FILE *)m_file;
-    if (!mp3File)
+    const unsigned char *frame = NULL;
+    int size = 0;
+
+    if (!GetNextFrame(frame, size))
         return false;
 
-    MpegAudioFrameInfo info;
-    MpegAudioResult ret = {0, 0};
-    int readLen = 0;
-    char mp3Buff[4608];
+    mp3data.assign(frame, frame + size);
+    return true;
+}
 
-    fseek(mp3File, 0, SEEK_SET); // 回到文件头
-    fseek(mp3File, m_nextPos, SEEK_SET); // 下一帧的位置
+/*
+ * 零拷贝获取一帧MP3数据
+ * frame：指向映射区中的帧起始地址，在Mp3FileParse销毁前有效
+ * size：帧大小，单位字节
+ * info：不为NULL时返回帧信息
+ * return：成功返回true，失败返回false
+ */
+bool Mp3FileParse::GetNextFrame(const unsigned char *&frame, int &size, MpegAudioFrameInfo *info)
+{
+    EasyMp3StageScope stage(EASY_MP3_STAGE_PARSE);
+    MpegAudioFrameInfo tmp;
+    long framePos = 0, pos = m_nextPos;
 
-    readLen = fread(mp3Buff, 1, sizeof(mp3Buff), mp3File);
+    if (!info)
+        info = &tmp;
+    if (!findNextMpegAudioFrame(m_data, m_size, pos, m_firstFrame, framePos, info))
+        return false;
+
+    m_lastPos = m_nextPos;
+    m_lastFirstFrame = m_firstFrame;
+    m_nextPos = pos;
+    frame = m_data + framePos;
+    size = info->frameSize;
+    m_firstFrame = false;
+    return true;
+}
 
-    ret = findMpegAudioFramePos((unsigned char *)mp3Buff, readLen, &info, (m_nextPos == 0) ? true : false);
-    if (ret.errCode == MPEG_AUDIO_OK)
+/* 退回上一次GetNextFrame()取出的帧 */
+void Mp3FileParse::UngetFrame()
+{
+    m_nextPos = m_lastPos;
+    m_firstFrame = m_lastFirstFrame;
+}
+
+/* 建立帧索引，只在第一次调用时扫描文件 */
+const Mp3FrameIndex &Mp3FileParse::GetIndex()
+{
+    if (!m_indexed)
     {
-        if (m_nextPos == 0) // 第一帧
-            memmove(mp3Buff, mp3Buff + (ret.nextPos - info.frameSize), info.frameSize);
+        m_index.Build(m_data, m_size);
+        m_indexed = true;
+    }
+    return m_index;
+}
 
-        mp3data.clear();
-        mp3data.assign(mp3Buff, mp3Buff + info.frameSize);
+/*
+ * 定位到包含时间点ms的帧，下一次GetNextFrame()从该帧开始
+ * return：成功返回帧序号，失败返回-1
+ */
+int Mp3FileParse::SeekTo(unsigned int ms)
+{
+    int n = GetIndex().Find(ms);
+    if (n < 0 || !SeekToFrame(n))
+        return -1;
+    return n;
+}
 
-        m_nextPos += ret.nextPos;
+/* 定位到第n帧(以帧索引为准) */
+bool Mp3FileParse::SeekToFrame(int n)
+{
+    const Mp3FrameIndex &index = GetIndex();
+    if (n < 0 || n >= index.Count())
+        return false;
 
-        return true;
-    }
-    else if (ret.errCode == MPEG_AUDIO_NEED_MORE) // 需要更多数据
+    // 索引不含ID3标签和XING/INFO/VBRI帧，直接从第n个音频帧开始
+    m_nextPos = index.Offset(n);
+    m_firstFrame = false;
+    return true;
+}
+
+/* 解析第一帧，获取XING/VBRI头信息，只在第一次调用时解析 */
+bool Mp3FileParse::ProbeFirstFrame()
+{
+    if (!m_probed)
     {
-        if (feof(mp3File))
+        long pos = 0, framePos = 0;
+        if (findNextMpegAudioFrame(m_data, m_size, pos, true, framePos, &m_firstInfo))
         {
-            return false;
+            m_firstPos = framePos;
+            m_audioStart = framePos;
+            if (m_firstInfo.bitrateType) // XING/INFO/VBRI帧不含音频数据
+                m_audioStart += m_firstInfo.frameSize;
         }
+        m_probed = true;
+    }
+    return m_firstPos >= 0;
+}
 
-        char *newBuf = new char[ret.nextPos];
+/* 按第一帧信息估算的总时长，单位ms，不扫描整个文件 */
+unsigned int Mp3FileParse::GetEstimatedDuration()
+{
+    if (m_indexed)
+        return m_index.Duration();
 
-        fseek(mp3File, 0, SEEK_SET); // 回到文件头
-        fseek(mp3File, m_nextPos, SEEK_SET); // 下一帧的位置
+    if (!ProbeFirstFrame() || m_firstInfo.samplerate <= 0)
+        return 0;
 
-        readLen = fread(newBuf, 1, ret.nextPos, mp3File);
+    if (m_firstInfo.totalFrames > 0) // VBR头中记录了总帧数
+        return (unsigned int)((double)m_firstInfo.totalFrames * m_firstInfo.samplesPerFrame * 1000 / m_firstInfo.samplerate);
 
-        if (readLen != ret.nextPos)
-        {
-            delete []newBuf;
-            return false;
-        }
+    if (m_firstInfo.bitrate <= 0) // free format
+        return 0;
 
-        ret = findMpegAudioFramePos((unsigned char *)newBuf, readLen, &info, (m_nextPos == 0) ? true : false);
+    return (unsigned int)((double)(m_size - m_audioStart) * 8 / m_firstInfo.bitrate); // 按CBR计算
+}
 
-        if (ret.errCode == MPEG_AUDIO_OK)
-        {
-            if (m_nextPos == 0) // 第一帧
-                memmove(newBuf, newBuf + (ret.nextPos - info.frameSize), info.frameSize);
+/* 估算时间点ms所在的字节偏移 */
+long Mp3FileParse::EstimateOffset(unsigned int ms, unsigned int duration)
+{
+    const MpegAudioFrameInfo &info = m_firstInfo;
+    double percent = (double)ms * 100 / duration;
+
+    if (info.bitrateType == 2 && info.TOCTable) // XING：100项，每项为总字节数的1/256
+    {
+        long totalBytes = info.totalBytes > 0 ? info.totalBytes : m_size - m_firstPos;
+        int a = (int)percent;
+        if (a > 99)
+            a = 99;
 
-            mp3data.clear();
-            mp3data.assign(newBuf, newBuf + info.frameSize);
+        double fa = info.TOCTable[a];
+        double fb = a < 99 ? info.TOCTable[a + 1] : 256.0;
+        double fx = fa + (fb - fa) * (percent - a);
+        return m_firstPos + (long)(fx / 256.0 * totalBytes);
+    }
 
-            m_nextPos += ret.nextPos;
+    if (info.bitrateType == 3 && info.TOCTable && info.framesNumPerTable > 0) // VBRI：每项为若干帧的字节数
+    {
+        double entryMs = (double)info.framesNumPerTable * info.samplesPerFrame * 1000 / info.samplerate;
+        double t = 0;
+        long offset = m_audioStart;
+        const unsigned char *p = info.TOCTable;
+
+        for (int i = 0; i < info.entriesNumInTOCTable; i++, p += info.entrySize)
+        {
+            long bytes = 0;
+            for (int k = 0; k < info.entrySize; k++) // 大端
+                bytes = (bytes << 8) | p[k];
+            bytes *= info.TOCTableFactor;
 
-            delete []newBuf;
+            if (t + entryMs > ms) // 在该项内线性插值
+                return offset + (long)(bytes * (ms - t) / entryMs);
 
-            return true;
+            t += entryMs;
+            offset += bytes;
         }
-        delete []newBuf;
+        return offset;
     }
 
-    return false;
+    // CBR或者没有TOC表：按字节线性估算
+    return m_audioStart + (long)((double)(m_size - m_audioStart) * ms / duration);
 }
 
+/*
+ * 近似跳转到时间点ms，不扫描整个文件
+ * return：成功返回true，失败返回false
+ */
+bool Mp3FileParse::SeekApprox(unsigned int ms)
+{
+    if (m_indexed) // 已有帧索引，直接精确跳转
+        return SeekTo(ms) >= 0;
 
+    unsigned int duration = GetEstimatedDuration();
+    if (duration == 0 || ms >= duration)
+        return false;
+
+    if (ms == 0)
+    {
+        m_nextPos = 0;
+        m_firstFrame = true;
+        return true;
+    }
+
+    long offset = EstimateOffset(ms, duration);
+    if (offset < m_audioStart)
+        offset = m_audioStart;
 
+    long pos = resyncMpegAudioFrame(m_data, m_size, offset, &m_firstInfo, 64 * 1024);
+    if (pos < 0)
+        return false;
 
+    m_nextPos = pos;
+    m_firstFrame = false;
+    return true;
+}
@@ -3,9 +3,12 @@
 
 #include <string>
 #include <vector>
+#include "easy_mp3_frame_index.h"
 using namespace std;
 
 // 完成MP3文件的逐帧提取
+// 文件通过mmap映射到内存(映射失败时一次性读入内存)，逐帧顺序扫描，
+// 帧数据直接以指针形式交给调用者，不再每帧fseek/fread和拷贝
 
 class Mp3FileParse
 {
@@ -13,12 +16,71 @@ public:
     Mp3FileParse(const std::string &filename);
     ~Mp3FileParse();
 
+    /* 获取一帧MP3数据，拷贝到mp3data中 */
     bool GetNextFrame(std::vector<unsigned char> &mp3data);
 
+    /*
+     * 零拷贝获取一帧MP3数据
+     * frame：指向映射区中的帧起始地址，在Mp3FileParse销毁前有效
+     * size：帧大小，单位字节
+     * info：不为NULL时返回帧信息
+     */
+    bool GetNextFrame(const unsigned char *&frame, int &size, MpegAudioFrameInfo *info = NULL);
+
+    /* 退回上一次GetNextFrame()取出的帧，下一次GetNextFrame()重新取出该帧 */
+    void UngetFrame();
+
+    /* 第一帧(可能是XING/INFO/VBRI帧)的信息，只解析第一帧，不扫描整个文件，没有找到返回NULL */
+    const MpegAudioFrameInfo *GetFirstFrameInfo() { return ProbeFirstFrame() ? &m_firstInfo : NULL; }
+
+    /* 建立帧索引，只在第一次调用时扫描文件 */
+    const Mp3FrameIndex &GetIndex();
+
+    /*
+     * 定位到包含时间点ms的帧，下一次GetNextFrame()从该帧开始
+     * return：成功返回帧序号，失败返回-1
+     */
+    int SeekTo(unsigned int ms);
+
+    /* 定位到第n帧(以帧索引为准) */
+    bool SeekToFrame(int n);
+
+    /* 文件总时长，单位ms */
+    unsigned int GetDuration() { return GetIndex().Duration(); }
+
+    /*
+     * 近似跳转到时间点ms，不扫描整个文件
+     * 按第一帧中XING/VBRI的TOC表(没有则按CBR线性)估算字节偏移，再重新同步到下一个可靠帧头
+     * 若帧索引已经建立，则直接精确跳转
+     * return：成功返回true，失败返回false
+     */
+    bool SeekApprox(unsigned int ms);
+
+    /* 按第一帧信息估算的总时长，单位ms，不扫描整个文件 */
+    unsigned int GetEstimatedDuration();
+
+    /* 整个文件的数据，在Mp3FileParse销毁前有效，打开失败时为NULL */
+    const unsigned char *GetData() { return m_data; }
+    long GetSize() { return m_size; }
+
 private:
-    void *m_file;
-    int m_nextPos;
+    bool ProbeFirstFrame();
+    long EstimateOffset(unsigned int ms, unsigned int duration);
+
+private:
+    const unsigned char *m_data; // 文件数据起始地址
+    long m_size; // 文件大小
+    bool m_mapped; // true：mmap映射，false：读入的堆内存
+    long m_nextPos; // 下一帧的查找位置
+    bool m_firstFrame; // 下一帧是否为第一帧(需要处理ID3和XING/VBRI)
+    long m_lastPos; // 上一次GetNextFrame()之前的m_nextPos，用于UngetFrame()
+    bool m_lastFirstFrame; // 上一次GetNextFrame()之前的m_firstFrame
+    bool m_indexed; // 帧索引是否已经建立
+    Mp3FrameIndex m_index; // 帧索引
+    bool m_probed; // 第一帧是否已经解析
+    long m_firstPos; // 第一帧的偏移，-1表示没有找到
+    long m_audioStart; // 音频帧起始偏移(跳过XING/INFO/VBRI帧)
+    MpegAudioFrameInfo m_firstInfo; // 第一帧信息，TOC表指向映射区
 };
 
 #endif
-
@@ -0,0 +1,155 @@
+/*
+ * MP3数据流逐帧提取
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#include "mp3_stream_parse.h"
+#include "print_log.h"
+#include <string.h>
+
+#define MP3_STREAM_MIN_CAPACITY 4096 // MPEG-1 Layer I/II/III最大帧长都小于4096字节
+
+Mp3StreamParse::Mp3StreamParse(int capacity)
+{
+    if (capacity < MP3_STREAM_MIN_CAPACITY)
+        capacity = MP3_STREAM_MIN_CAPACITY;
+
+    m_buf = new unsigned char[capacity];
+    m_capacity = capacity;
+    Reset();
+}
+
+Mp3StreamParse::~Mp3StreamParse()
+{
+    if (m_buf)
+        delete []m_buf;
+    m_buf = NULL;
+}
+
+void Mp3StreamParse::Reset()
+{
+    m_start = m_end = 0;
+    m_firstFrame = true;
+    m_eos = false;
+    m_skip = 0;
+}
+
+/*
+ * 送入数据，缓冲区满时只接收一部分
+ * return：接收的字节数
+ */
+int Mp3StreamParse::Push(const unsigned char *data, int size)
+{
+    if (!data || size <= 0 || m_eos)
+        return 0;
+
+    // 丢弃ID3V2标签的剩余部分，不进缓冲区
+    int skipped = 0;
+    if (m_skip > 0)
+    {
+        skipped = m_skip < size ? (int)m_skip : size;
+        m_skip -= skipped;
+        data += skipped;
+        size -= skipped;
+    }
+
+    // 已取走的数据移出缓冲区，剩余的不超过一帧
+    if (m_start > 0)
+    {
+        memmove(m_buf, m_buf + m_start, m_end - m_start);
+        m_end -= m_start;
+        m_start = 0;
+    }
+
+    int n = m_capacity - m_end;
+    if (n > size)
+        n = size;
+    memcpy(m_buf + m_end, data, n);
+    m_end += n;
+    return skipped + n;
+}
+
+void Mp3StreamParse::PushEnd()
+{
+    m_eos = true;
+}
+
+/*
+ * 取出一帧MP3数据
+ * 按findMpegAudioFramePos()的约定：不完整的帧返回MPEG_AUDIO_NEED_MORE，
+ * 帧头之前的无效数据直接丢弃，等更多数据到达后从帧头处重新解析
+ */
+int Mp3StreamParse::GetNextFrame(const unsigned char *&frame, int &size)
+{
+    MpegAudioFrameInfo info;
+    int more = m_eos ? MPEG_AUDIO_ERR : MPEG_AUDIO_NEED_MORE;
+
+    while (true)
+    {
+        int avail = m_end - m_start;
+        unsigned char *buf = m_buf + m_start;
+
+        if (m_firstFrame && m_skip == 0 && avail >= 3 && memcmp(buf, "ID3", 3) == 0)
+        {
+            if (avail < 10) // 标签头10个字节
+                return more;
+
+            // 标签大小为4个7位整数，不含10个字节的标签头，带footer时再加10个字节
+            m_skip = ((long)(buf[6] & 0x7f) << 21) | ((buf[7] & 0x7f) << 14) | ((buf[8] & 0x7f) << 7) | (buf[9] & 0x7f);
+            m_skip += (buf[5] & 0x10) ? 20 : 10;
+            LOG("stream ID3 tag: %ld bytes\n", m_skip);
+        }
+
+        if (m_skip > 0)
+        {
+            int n = m_skip < avail ? (int)m_skip : avail;
+            m_start += n;
+            m_skip -= n;
+            if (m_skip > 0)
+                return more;
+            continue;
+        }
+
+        if (avail < 4) // 帧头至少有4个字节
+            return more;
+
+        MpegAudioResult ret = findMpegAudioFramePos(buf, avail, &info, m_firstFrame);
+        if (ret.errCode == MPEG_AUDIO_OK && info.frameSize >= 4)
+        {
+            int framePos = ret.nextPos - info.frameSize;
+            if (ret.nextPos > avail) // 帧不完整，丢弃帧头之前的数据，等待更多数据
+            {
+                m_start += framePos;
+                if (info.frameSize > m_capacity) // 缓冲区放不下，不是有效的帧头
+                {
+                    m_start++;
+                    continue;
+                }
+                if (m_eos) // 最后一帧不完整
+                    m_start = m_end;
+                return more;
+            }
+
+            frame = buf + framePos;
+            size = info.frameSize;
+            m_start += ret.nextPos;
+            m_firstFrame = false;
+            return MPEG_AUDIO_OK;
+        }
+
+        // 没有找到帧头，或者帧头不完整：丢弃帧头之前的数据
+        int drop = ret.nextPos < avail ? ret.nextPos : avail;
+        if (drop > 0)
+        {
+            m_start += drop;
+            continue;
+        }
+
+        if (m_eos)
+            m_start = m_end;
+        else if (avail == m_capacity) // 缓冲区满了仍然无法解析，跳过一个字节
+            m_start++;
+        return more;
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * MP3数据流逐帧提取
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2025 by liuqingshuige
+ */
+#ifndef __FREE_MP3_STREAM_PARSE_H__
+#define __FREE_MP3_STREAM_PARSE_H__
+
+#include "easy_mp3_parse_frame.h"
+
+// 推送式的MP3帧提取：调用者分多次送入任意长度的数据(如网络收到的数据)，逐帧取出
+// 只在固定大小的缓冲区中保留未取走的数据，不需要缓存整个文件，
+// 开头的ID3V2标签边收边丢弃，标签再大也不占用缓冲区
+class Mp3StreamParse
+{
+public:
+    /* capacity：缓冲区大小，须能放下最大的一帧 */
+    Mp3StreamParse(int capacity);
+    ~Mp3StreamParse();
+
+    /*
+     * 送入数据，缓冲区满时只接收一部分，取走若干帧之后再送入剩余部分
+     * return：接收的字节数
+     */
+    int Push(const unsigned char *data, int size);
+
+    /* 数据已经全部送入 */
+    void PushEnd();
+
+    /*
+     * 取出一帧MP3数据
+     * frame：指向缓冲区中的帧起始地址，在下一次调用Push()或GetNextFrame()之前有效
+     * size：帧大小，单位字节
+     * return：MPEG_AUDIO_OK成功；MPEG_AUDIO_NEED_MORE需要送入更多数据；
+     *         MPEG_AUDIO_ERR已经PushEnd()且没有完整的帧了
+     */
+    int GetNextFrame(const unsigned char *&frame, int &size);
+
+    /* 清空缓冲区，开始一段新的数据流 */
+    void Reset();
+
+    /* 缓冲区中还没有取走的字节数 */
+    int Buffered() { return m_end - m_start; }
+
+private:
+    unsigned char *m_buf;
+    int m_capacity;
+    int m_start, m_end; // 缓冲区中有效数据的范围
+    bool m_firstFrame; // 下一帧是否为第一帧(需要处理ID3和XING/VBRI)
+    bool m_eos; // 是否已经PushEnd()
+    long m_skip; // ID3V2标签还需要丢弃的字节数
+};
+
+#endif
@@ -1,7 +1,30 @@
+
 #include "print_log.h"
+#include <pthread.h>
+#include <atomic>
 
 int g_run_log_level = RUN_LOG_INFO; // 默认信息
 static FILE *g_run_log_file = 0; // 默认输出到控制台
+static long g_run_log_size = 0; // 当前日志文件大小，超过RUN_LOG_MAX_SIZE时轮转
+static pthread_mutex_t g_run_log_file_mutex = PTHREAD_MUTEX_INITIALIZER; // 保护写文件和轮转：同步输出和后台线程写出时都要持有
+
+#define RUN_LOG_QUEUE_SIZE (64 * 1024) // 每个线程的日志队列大小，须为2的幂
+#define RUN_LOG_LINE_MAX 4096 // 单条日志最大长度，超出部分截断
+#define RUN_LOG_FLUSH_US 10000 // 后台线程的写出周期
+
+// 日志文件超过RUN_LOG_MAX_SIZE时改名为RUN_LOG_FILE.1(覆盖上一个)，重新创建日志文件
+static void run_log_rotate(void)
+{
+	if (!g_run_log_file || g_run_log_file == stderr || g_run_log_size <= RUN_LOG_MAX_SIZE)
+		return;
+
+	fclose(g_run_log_file);
+	rename(RUN_LOG_FILE, RUN_LOG_FILE ".1");
+	g_run_log_file = fopen(RUN_LOG_FILE, "w");
+	if (!g_run_log_file) // 创建失败
+		g_run_log_file = stderr;
+	g_run_log_size = 0;
+}
 
 // level: 打印级别
 // stderr_or_file: 输出到标准错误还是文件，0表示标准错误，其他表示文件
@@ -10,26 +33,18 @@ void run_init_log(int level, int stderr_or_file)
 	if (level>=RUN_LOG_ALERT && level<=RUN_LOG_DBG) // 限制范围
 		g_run_log_level = level;
 
-	if (stderr_or_file) // 如果是输出到指定文件
+	g_run_log_size = 0;
+	if (stderr_or_file) // 如果是输出到指定文件，追加到尾巴
 	{
-		g_run_log_file = fopen(RUN_LOG_FILE, "r+");
-		if (!g_run_log_file) // 若文件不存在
+		g_run_log_file = fopen(RUN_LOG_FILE, "a");
+		if (g_run_log_file == NULL) // 打开失败
+			g_run_log_file = stderr;
+		else
 		{
-			g_run_log_file = fopen(RUN_LOG_FILE, "w"); // 创建文件
-			if (g_run_log_file == NULL) // 创建失败
-				g_run_log_file = stderr;
-			else
-			{
-				fclose(g_run_log_file); // 关闭
-				g_run_log_file = fopen(RUN_LOG_FILE, "r+"); // 重新打开
-				if (g_run_log_file == NULL) // 打开失败
-					g_run_log_file = stderr;
-				else
-					fseek(g_run_log_file, 0, SEEK_END); // 到尾巴
-			}
+			fseek(g_run_log_file, 0, SEEK_END);
+			g_run_log_size = ftell(g_run_log_file);
+			run_log_rotate();
 		}
-		else
-			fseek(g_run_log_file, 0, SEEK_END); // 到尾巴
 	}
 	else
 		g_run_log_file = stderr;
@@ -44,35 +59,272 @@ int run_set_log_level(int level)
 	return old;
 }
 
+//////>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+// 异步输出：每个线程一个单生产者单消费者的环形队列，
+// 打印线程只格式化并放入本线程的队列，不加锁不做I/O；后台线程定期取出全部队列，合并成一次写出
+
+// 队列中的一条日志：4字节长度 + 内容，按4字节对齐，长度字段不会跨越队列尾部
+typedef struct RunLogQueue
+{
+	std::atomic<unsigned long> head; // 后台线程读取的位置
+	std::atomic<unsigned long> tail; // 打印线程写入的位置
+	std::atomic<bool> closed; // 线程已经退出，取完之后由后台线程释放
+	unsigned char data[RUN_LOG_QUEUE_SIZE];
+}RunLogQueue;
+
+static std::atomic<bool> g_run_log_async(false);
+static pthread_t g_run_log_thread;
+static std::atomic<bool> g_run_log_stop(false);
+static pthread_mutex_t g_run_log_mutex = PTHREAD_MUTEX_INITIALIZER; // 只保护队列列表，注册和后台线程遍历时使用
+static RunLogQueue *g_run_log_queues[1024];
+static int g_run_log_queue_num = 0;
+static std::atomic<unsigned long> g_run_log_dropped(0); // 队列满丢弃的日志条数
+
+// 线程退出时标记本线程的队列，由后台线程取完剩余日志后释放
+class RunLogQueueSlot
+{
+public:
+	RunLogQueueSlot() : queue(0), exited(false) {}
+	~RunLogQueueSlot()
+	{
+		if (queue)
+			queue->closed.store(true, std::memory_order_release);
+		queue = 0; // 标记之后队列可能随时被后台线程释放
+		exited = true;
+	}
+
+	RunLogQueue *queue;
+	bool exited; // 之后其他thread_local析构时的日志不再创建队列，改为同步输出
+};
+
+static thread_local RunLogQueueSlot t_run_log_slot;
+
+// 本线程的队列，第一次打印时创建并注册
+static RunLogQueue *run_log_queue(void)
+{
+	RunLogQueue *q = t_run_log_slot.queue;
+	if (q || t_run_log_slot.exited)
+		return q;
+
+	pthread_mutex_lock(&g_run_log_mutex);
+	if (g_run_log_queue_num < (int)(sizeof(g_run_log_queues) / sizeof(g_run_log_queues[0])))
+	{
+		q = new RunLogQueue();
+		q->head.store(0, std::memory_order_relaxed);
+		q->tail.store(0, std::memory_order_relaxed);
+		q->closed.store(false, std::memory_order_relaxed);
+		g_run_log_queues[g_run_log_queue_num++] = q;
+	}
+	pthread_mutex_unlock(&g_run_log_mutex);
+
+	t_run_log_slot.queue = q;
+	return q;
+}
+
+// 放入本线程的队列，队列满时丢弃；没有队列时返回false，由调用者同步输出
+static bool run_log_push(const char *msg, int len)
+{
+	RunLogQueue *q = run_log_queue();
+	if (!q)
+		return false;
+
+	unsigned int need = (4 + len + 3) & ~3;
+	unsigned long tail = q->tail.load(std::memory_order_relaxed);
+	unsigned long head = q->head.load(std::memory_order_acquire);
+	if (RUN_LOG_QUEUE_SIZE - (tail - head) < need)
+	{
+		g_run_log_dropped.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	unsigned int pos = tail & (RUN_LOG_QUEUE_SIZE - 1);
+	memcpy(q->data + pos, &len, 4);
+	pos = (pos + 4) & (RUN_LOG_QUEUE_SIZE - 1);
+	unsigned int first = RUN_LOG_QUEUE_SIZE - pos; // 到队列尾部的空间
+	if (first >= (unsigned int)len)
+		memcpy(q->data + pos, msg, len);
+	else
+	{
+		memcpy(q->data + pos, msg, first);
+		memcpy(q->data, msg + first, len - first);
+	}
+	q->tail.store(tail + need, std::memory_order_release);
+	return true;
+}
+
+// 取出队列中的全部日志追加到batch
+static void run_log_drain(RunLogQueue *q, char *batch, int &batch_len, int batch_cap)
+{
+	unsigned long head = q->head.load(std::memory_order_relaxed);
+	unsigned long tail = q->tail.load(std::memory_order_acquire);
+
+	while (head != tail)
+	{
+		int len = 0;
+		unsigned int pos = head & (RUN_LOG_QUEUE_SIZE - 1);
+		memcpy(&len, q->data + pos, 4);
+		if (batch_len + len > batch_cap) // batch满了，先写出
+		{
+			pthread_mutex_lock(&g_run_log_file_mutex);
+			fwrite(batch, 1, batch_len, g_run_log_file);
+			g_run_log_size += batch_len;
+			pthread_mutex_unlock(&g_run_log_file_mutex);
+			batch_len = 0;
+		}
+
+		pos = (pos + 4) & (RUN_LOG_QUEUE_SIZE - 1);
+		unsigned int first = RUN_LOG_QUEUE_SIZE - pos;
+		if (first >= (unsigned int)len)
+			memcpy(batch + batch_len, q->data + pos, len);
+		else
+		{
+			memcpy(batch + batch_len, q->data + pos, first);
+			memcpy(batch + batch_len + first, q->data, len - first);
+		}
+		batch_len += len;
+		head += (4 + len + 3) & ~3;
+	}
+	q->head.store(head, std::memory_order_release);
+}
+
+// 取出全部队列写出一次，释放已经退出的线程的队列
+static void run_log_flush_queues(char *batch, int batch_cap)
+{
+	int batch_len = 0;
+
+	pthread_mutex_lock(&g_run_log_mutex);
+	for (int i = 0; i < g_run_log_queue_num; i++)
+	{
+		RunLogQueue *q = g_run_log_queues[i];
+		bool closed = q->closed.load(std::memory_order_acquire); // 先读closed，之后不会再有新的日志
+		run_log_drain(q, batch, batch_len, batch_cap);
+		if (closed)
+		{
+			delete q;
+			g_run_log_queues[i--] = g_run_log_queues[--g_run_log_queue_num];
+		}
+	}
+	pthread_mutex_unlock(&g_run_log_mutex);
+
+	unsigned long dropped = g_run_log_dropped.exchange(0, std::memory_order_relaxed);
+	if (dropped > 0 && batch_len + 64 <= batch_cap)
+		batch_len += snprintf(batch + batch_len, 64, "[log] %lu messages dropped\n", dropped);
+
+	if (batch_len > 0)
+	{
+		// 取队列时不持有文件锁，只在写文件和轮转时与同步输出互斥
+		pthread_mutex_lock(&g_run_log_file_mutex);
+		fwrite(batch, 1, batch_len, g_run_log_file);
+		fflush(g_run_log_file);
+		g_run_log_size += batch_len;
+		run_log_rotate();
+		pthread_mutex_unlock(&g_run_log_file_mutex);
+	}
+}
+
+static void *run_log_thread(void *)
+{
+	int batch_cap = RUN_LOG_QUEUE_SIZE;
+	char *batch = (char *)malloc(batch_cap);
+	if (!batch)
+		return NULL;
+
+	while (!g_run_log_stop.load(std::memory_order_acquire))
+	{
+		usleep(RUN_LOG_FLUSH_US);
+		run_log_flush_queues(batch, batch_cap);
+	}
+
+	free(batch);
+	return NULL;
+}
+
+// 同run_init_log()，之后的日志由后台线程异步写出
+int run_init_log_async(int level, int stderr_or_file)
+{
+	run_init_log(level, stderr_or_file);
+	if (g_run_log_async.load())
+		return 0;
+
+	g_run_log_stop.store(false);
+	if (pthread_create(&g_run_log_thread, NULL, run_log_thread, NULL) != 0)
+		return -1; // 仍然同步输出
+
+	g_run_log_async.store(true, std::memory_order_release);
+	atexit(run_log_exit); // 没有调用run_log_exit()就退出时，也要写出队列中的日志
+	return 0;
+}
+
 // 退出日志记录
 void run_log_exit(void)
 {
+	if (g_run_log_async.load())
+	{
+		g_run_log_async.store(false, std::memory_order_release); // 之后的日志同步输出
+		g_run_log_stop.store(true, std::memory_order_release);
+		pthread_join(g_run_log_thread, NULL);
+
+		// 后台线程退出之后再写出一次：已经判断为异步输出的线程可能在它最后一次取出之后才放入队列
+		char *batch = (char *)malloc(RUN_LOG_QUEUE_SIZE);
+		if (batch)
+		{
+			run_log_flush_queues(batch, RUN_LOG_QUEUE_SIZE);
+			free(batch);
+		}
+	}
+
 	if (g_run_log_file && g_run_log_file!=stderr)
 		fclose(g_run_log_file);
 	g_run_log_file = 0;
 }
 
+// 同步写出一条已经格式化的日志
+static void run_log_write(const char *line, int len)
+{
+	pthread_mutex_lock(&g_run_log_file_mutex);
+	if (g_run_log_file)
+	{
+		fwrite(line, 1, len, g_run_log_file);
+		if (g_run_log_file != stderr)
+		{
+			g_run_log_size += len;
+			run_log_rotate();
+		}
+	}
+	pthread_mutex_unlock(&g_run_log_file_mutex);
+}
+
 // 日志输出
 void run_log_print(const char *format, ...)
 {
 	if (!g_run_log_file)
         return;
 
-	// 获取文件大小先
-	if (g_run_log_file != stderr)
-	{
-		int pos = ftell(g_run_log_file); // 保存当前指针位置
-		if (pos > RUN_LOG_MAX_SIZE) // 已经达到最大值了
-			fseek(g_run_log_file, 0, SEEK_SET); // 回到文件头，覆盖之前的
-		else
-			fseek(g_run_log_file, pos, SEEK_SET); // 回到之前的位置
-	}
-
 	va_list ap;
 	va_start(ap, format);
-	vfprintf(g_run_log_file, format, ap);
+	if (g_run_log_async.load(std::memory_order_acquire)) // 只格式化，由后台线程写出
+	{
+		char line[RUN_LOG_LINE_MAX];
+		int len = vsnprintf(line, sizeof(line), format, ap);
+		if (len >= (int)sizeof(line))
+			len = sizeof(line) - 1;
+		if (len > 0 && !run_log_push(line, len))
+			run_log_write(line, len);
+	}
+	else
+	{
+		// 轮转会关闭文件，不能与其他线程的写并发
+		pthread_mutex_lock(&g_run_log_file_mutex);
+		if (g_run_log_file)
+		{
+			int len = vfprintf(g_run_log_file, format, ap);
+			if (len > 0 && g_run_log_file != stderr)
+			{
+				g_run_log_size += len;
+				run_log_rotate();
+			}
+		}
+		pthread_mutex_unlock(&g_run_log_file_mutex);
+	}
 	va_end(ap);
 }
-
-
-
@@ -13,7 +13,7 @@
 extern int g_run_log_level;
 
 #define RUN_LOG_FILE	"mp3_convert.log"
-#define RUN_LOG_MAX_SIZE  (5*1024*1024) // 512kB 最大的日志文件大小
+#define RUN_LOG_MAX_SIZE  (5*1024*1024) // 5MB 最大的日志文件大小，超过时改名为RUN_LOG_FILE.1
 #define RUN_LOG_ALERT -3	/*!< Alert level */
 #define RUN_LOG_CRIT  -2	/*!< Critical level */
 #define RUN_LOG_ERR   -1	/*!< Error level */
@@ -30,12 +30,30 @@ extern int g_run_log_level;
 #define RUN_LOG_INFO_PREFIX   "[%s %s:%d I] "
 #define RUN_LOG_DBG_PREFIX    "[%s %s:%d D] "
 
+// 编译期的最低日志级别，低于该级别(数值更大)的打印在编译时整个去掉，不再判断g_run_log_level，也不生成代码
+// 如只保留警告及以上：make CFLAG=-DRUN_LOG_MIN_LEVEL=1
+#ifndef RUN_LOG_MIN_LEVEL
+#define RUN_LOG_MIN_LEVEL RUN_LOG_DBG
+#endif
+
+// 该级别是否编译进来，常量表达式，为false时编译器直接去掉整个分支
+template <int _level>
+struct RunLogCompiled
+{
+	static constexpr bool value = (_level <= RUN_LOG_MIN_LEVEL);
+};
+#define run_is_compiled(_level)  (RunLogCompiled<(_level)>::value)
+
 // 可否打印该信息
 #define run_is_printable(_level)  ((g_run_log_level) >= ((int)(_level)))
+#define run_is_enabled(_level)  (run_is_compiled(_level) && run_is_printable(_level))
 
 // level: 打印级别，取值为上面的宏定义
 // stderr_or_file: 输出到标准错误还是文件，0表示标准错误，其他表示文件
 void run_init_log(int level, int stderr_or_file);
+// 同run_init_log()，由后台线程批量写出日志，打印线程只格式化后放入本线程的队列，不会阻塞在I/O上
+// 每个线程内的日志保持顺序，队列满时丢弃并统计条数；run_log_exit()时写出剩余的日志
+int run_init_log_async(int level, int stderr_or_file);
 // 按照format打印log到标准错误或者指定的文件
 void run_log_print(const char *format, ...);
 // 允许在运行时更改日志打印级别
@@ -44,24 +62,60 @@ int run_set_log_level(int level);
 void run_log_exit(void);
 
 static inline char *run_log_time(void)
-{
-    static char ctime_buf[128] = {0};
-    struct tm* t;
+{
+    static __thread char ctime_buf[128] = {0}; // 每个线程一份，多线程打印时互不覆盖
+    static __thread time_t ctime_sec = -1; // ctime_buf中已经格式化的秒，同一秒内只更新毫秒
     struct timeval tv;
     gettimeofday(&tv, NULL);
 
-    t = localtime(&tv.tv_sec);
-    snprintf(ctime_buf, sizeof(ctime_buf), "%04d-%02d-%02d %02d:%02d:%02d.%03d", 
-        t->tm_year+1900,
-        t->tm_mon+1,
-        t->tm_mday,
-        t->tm_hour,
-        t->tm_min,
-        t->tm_sec,
-        (int)tv.tv_usec/1000);
+    if (tv.tv_sec != ctime_sec)
+    {
+        struct tm tm_buf;
+        struct tm* t = localtime_r(&tv.tv_sec, &tm_buf);
+        snprintf(ctime_buf, sizeof(ctime_buf), "%04d-%02d-%02d %02d:%02d:%02d.",
+            t->tm_year+1900,
+            t->tm_mon+1,
+            t->tm_mday,
+            t->tm_hour,
+            t->tm_min,
+            t->tm_sec);
+        ctime_sec = tv.tv_sec;
+    }
+
+    int ms = (int)tv.tv_usec/1000; // "YYYY-mm-dd HH:MM:SS."之后的3位毫秒
+    ctime_buf[20] = '0' + ms/100;
+    ctime_buf[21] = '0' + ms/10%10;
+    ctime_buf[22] = '0' + ms%10;
+    ctime_buf[23] = 0;
     return ctime_buf;
 }
 
+static inline unsigned long long run_log_now_ms(void)
+{
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC_COARSE
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (unsigned long long)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+// 限频判断，last/count为调用点的状态，返回true时suppressed为上次输出之后被抑制的条数
+static inline bool run_log_ratelimit(unsigned long long *last, unsigned int *count, unsigned int interval_ms, unsigned int *suppressed)
+{
+    unsigned long long now = run_log_now_ms() + 1; // last为0表示还没有输出过
+    if (*last && now - *last < interval_ms)
+    {
+        (*count)++;
+        return false;
+    }
+    *last = now;
+    *suppressed = *count;
+    *count = 0;
+    return true;
+}
+
 // "[time function:line] alert: "
 #define RUN_LOG(_prefix, _fmt, ...) \
 	run_log_print(_prefix _fmt, run_log_time(), \
@@ -70,53 +124,71 @@ static inline char *run_log_time(void)
 // very urgent error
 #define RUN_ALERT(fmt, ...) \
 	do { \
-	if (run_is_printable(RUN_LOG_ALERT)){ \
+	if (run_is_enabled(RUN_LOG_ALERT)){ \
 	RUN_LOG(RUN_LOG_ALERT_PREFIX, fmt, ##__VA_ARGS__);\
 	} \
 	}while(0)
 
 #define RUN_CRIT(fmt, ...) \
 	do { \
-	if (run_is_printable(RUN_LOG_CRIT)){ \
+	if (run_is_enabled(RUN_LOG_CRIT)){ \
 	RUN_LOG(RUN_LOG_CRIT_PREFIX, fmt, ##__VA_ARGS__);\
 	} \
 	}while(0)
 
 #define RUN_ERR(fmt, ...) \
 	do { \
-	if (run_is_printable(RUN_LOG_ERR)){ \
+	if (run_is_enabled(RUN_LOG_ERR)){ \
 	RUN_LOG(RUN_LOG_ERR_PREFIX, fmt, ##__VA_ARGS__);\
 	} \
 	}while(0)
 
 #define RUN_WARN(fmt, ...) \
 	do { \
-	if (run_is_printable(RUN_LOG_WARN)){ \
+	if (run_is_enabled(RUN_LOG_WARN)){ \
 	RUN_LOG(RUN_LOG_WARN_PREFIX, fmt, ##__VA_ARGS__);\
 	} \
 	}while(0)
 
 #define RUN_NOTICE(fmt, ...) \
 	do { \
-	if (run_is_printable(RUN_LOG_NOTICE)){ \
+	if (run_is_enabled(RUN_LOG_NOTICE)){ \
 	RUN_LOG(RUN_LOG_NOTICE_PREFIX, fmt, ##__VA_ARGS__);\
 	} \
 	}while(0)
 
 #define RUN_INFO(fmt, ...) \
 	do { \
-	if (run_is_printable(RUN_LOG_INFO)){ \
+	if (run_is_enabled(RUN_LOG_INFO)){ \
 	RUN_LOG(RUN_LOG_INFO_PREFIX, fmt, ##__VA_ARGS__);\
 	} \
 	}while(0)
 
 #define RUN_DBG(fmt, ...) \
 	do { \
-	if (run_is_printable(RUN_LOG_DBG)){ \
+	if (run_is_enabled(RUN_LOG_DBG)){ \
 	RUN_LOG(RUN_LOG_DBG_PREFIX, fmt, ##__VA_ARGS__);\
 	} \
 	}while(0)
 
+// 限频输出：同一调用点在每个线程中每_ms毫秒最多输出一次，适合每帧都可能触发的日志，
+// 被抑制的条数在下一次输出时带上。时间用粗粒度时钟，被抑制时只有一次取时间和比较
+#define RUN_LOG_RATELIMIT(_level, _prefix, _ms, _fmt, ...) \
+	do { \
+	if (run_is_enabled(_level)){ \
+	static __thread unsigned long long _rl_last = 0; \
+	static __thread unsigned int _rl_count = 0; \
+	unsigned int _rl_suppressed = 0; \
+	if (run_log_ratelimit(&_rl_last, &_rl_count, (_ms), &_rl_suppressed)){ \
+	if (_rl_suppressed) \
+	run_log_print(_prefix "(%u suppressed) " _fmt, run_log_time(), \
+	__FUNCTION__, __LINE__, _rl_suppressed, ##__VA_ARGS__); \
+	else \
+	RUN_LOG(_prefix, _fmt, ##__VA_ARGS__); \
+	} \
+	} \
+	}while(0)
+
 #define LOG RUN_INFO
 #define LOGD RUN_DBG
 #define LOGI RUN_INFO
@@ -126,5 +198,10 @@ static inline char *run_log_time(void)
 #define LOGC RUN_CRIT
 #define LOGA RUN_ALERT
 
+#define LOG_RATELIMIT(_ms, fmt, ...) RUN_LOG_RATELIMIT(RUN_LOG_INFO, RUN_LOG_INFO_PREFIX, _ms, fmt, ##__VA_ARGS__)
+#define LOGD_RATELIMIT(_ms, fmt, ...) RUN_LOG_RATELIMIT(RUN_LOG_DBG, RUN_LOG_DBG_PREFIX, _ms, fmt, ##__VA_ARGS__)
+#define LOGW_RATELIMIT(_ms, fmt, ...) RUN_LOG_RATELIMIT(RUN_LOG_WARN, RUN_LOG_WARN_PREFIX, _ms, fmt, ##__VA_ARGS__)
+#define LOGE_RATELIMIT(_ms, fmt, ...) RUN_LOG_RATELIMIT(RUN_LOG_ERR, RUN_LOG_ERR_PREFIX, _ms, fmt, ##__VA_ARGS__)
+
 #endif
 
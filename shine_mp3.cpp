@@ -1,5 +1,6 @@
 /* shine_layer3.c */
 #include "shine_mp3.h"
+#include "easy_mp3_stats.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -278,21 +279,34 @@ typedef struct {
     int32_t en[MAX_GRANULES][21];
     int32_t xm[MAX_GRANULES][21];
     int32_t xrmaxl[MAX_GRANULES];
-    double steptab[128]; /* 2**(-x/4)  for x = -127..0 */
-    int32_t steptabi[128];  /* 2**(-x/4)  for x = -127..0 */
-    int int2idx[10000]; /* x**(3/4)   for x = 0..9999 */
+    const double *steptab;     /* shine_tables_t::steptab */
+    const int32_t *steptabi;   /* shine_tables_t::steptabi */
+    const int *int2idx;        /* shine_tables_t::int2idx */
 } l3loop_t;
 
 typedef struct {
-    int32_t cos_l[18][36];
+    const int32_t (*cos_l)[36]; /* shine_tables_t::cos_l */
+    const int32_t (*cos_t)[24]; /* shine_tables_t::cos_t */
 } mdct_t;
 
 typedef struct {
     int off[MAX_CHANNELS];
-    int32_t fl[SBLIMIT][64];
+    const int32_t (*fl)[64];    /* shine_tables_t::fl */
     int32_t x[MAX_CHANNELS][HAN_SIZE];
 } subband_t;
 
+/* Look up tables that only depend on constants. They are computed once per
+ * process and shared read-only by every encoder instance. */
+typedef struct {
+    double steptab[128];    /* 2**(-x/4)  for x = -127..0 */
+    int32_t steptabi[128];  /* 2**(-x/4)  for x = -127..0 */
+    int int2idx[10000];     /* x**(3/4)   for x = 0..9999 */
+    int32_t hlen[32][256];  /* code lengths of the big value tables as 32-bit words, for the gathers in count_bit */
+    int32_t cos_l[18][36];  /* combined window and mdct coefficients */
+    int32_t cos_t[36][24];  /* cos_l transposed, 18 outputs padded to 24 for the SIMD kernels */
+    int32_t fl[SBLIMIT][64]; /* analysis filterbank coefficients */
+} shine_tables_t;
+
 /* Side information */
 typedef struct {
     unsigned part2_3_length;
@@ -385,6 +399,9 @@ typedef struct shine_global_flags {
     l3loop_t l3loop;
     mdct_t mdct;
     subband_t subband;
+    int rate_control;                  /* shine_rate_control_t, kept by shine_reset */
+    int last_step[MAX_CHANNELS];       /* SHINE_RC_FAST: step size of the previous granule */
+    int last_step_valid[MAX_CHANNELS];
 } shine_global_config;
 
 
@@ -584,6 +601,8 @@ void shine_ResvFrameEnd(shine_global_config *config);
 
 #include <stdint.h>
 
+void shine_subband_tables(shine_tables_t *tab);
+
 void shine_subband_initialise(shine_global_config *config);
 
 void shine_window_filter_subband(int16_t **buffer, int32_t s[SBLIMIT], int k, shine_global_config *config, int stride);
@@ -593,6 +612,8 @@ void shine_window_filter_subband(int16_t **buffer, int32_t s[SBLIMIT], int k, sh
 #ifndef shine_MDCT_H
 #define shine_MDCT_H
 
+void shine_mdct_tables(shine_tables_t *tab);
+
 void shine_mdct_initialise(shine_global_config *config);
 
 void shine_mdct_sub(shine_global_config *config, int stride);
@@ -602,6 +623,8 @@ void shine_mdct_sub(shine_global_config *config, int stride);
 #ifndef L3LOOP_H
 #define L3LOOP_H
 
+void shine_loop_tables(shine_tables_t *tab);
+
 void shine_loop_initialise(shine_global_config *config);
 
 void shine_iteration_loop(shine_global_config *config);
@@ -888,17 +911,27 @@ int shine_samples_per_pass(shine_t s) {
     return s->mpeg.granules_per_frame * GRANULE_SIZE;
 }
 
-/* Compute default encoding values. */
-shine_global_config *shine_initialise(shine_config_t *pub_config) {
-    double avg_slots_per_frame;
-    shine_global_config *config;
+static shine_tables_t *shine_build_tables(void) {
+    shine_tables_t *tab = (shine_tables_t *)malloc(sizeof(shine_tables_t));
+    if (tab != NULL) {
+        shine_subband_tables(tab);
+        shine_mdct_tables(tab);
+        shine_loop_tables(tab);
+    }
+    return tab;
+}
 
-    if (shine_check_config(pub_config->wave.samplerate, pub_config->mpeg.bitr) < 0)
-        return NULL;
+/* The shared tables, built by the first caller. Initialisation of a function
+ * local static is thread safe, so encoders may be created concurrently. */
+static const shine_tables_t *shine_get_tables(void) {
+    static const shine_tables_t *tables = shine_build_tables();
+    return tables;
+}
 
-    config = (shine_global_config *)calloc(1, sizeof(shine_global_config));
-    if (config == NULL)
-        return config;
+/* Compute default encoding values. The bit stream must already be open and
+ * everything else zeroed. */
+static void shine_setup(shine_global_config *config, shine_config_t *pub_config) {
+    double avg_slots_per_frame;
 
     shine_subband_initialise(config);
     shine_mdct_initialise(config);
@@ -950,8 +983,6 @@ shine_global_config *shine_initialise(shine_config_t *pub_config) {
     if (config->mpeg.frac_slots_per_frame == 0)
         config->mpeg.padding = 0;
 
-    shine_open_bit_stream(&config->bs, BUFFER_SIZE);
-
     memset((char *) &config->side_info, 0, sizeof(shine_side_info_t));
 
     /* determine the mean bitrate for main data */
@@ -959,15 +990,59 @@ shine_global_config *shine_initialise(shine_config_t *pub_config) {
         config->sideinfo_len = 8 * ((config->wave.channels == 1) ? 4 + 17 : 4 + 32);
     else                /* MPEG 2 */
         config->sideinfo_len = 8 * ((config->wave.channels == 1) ? 4 + 9 : 4 + 17);
+}
 
+shine_global_config *shine_initialise(shine_config_t *pub_config) {
+    shine_global_config *config;
+
+    if (shine_check_config(pub_config->wave.samplerate, pub_config->mpeg.bitr) < 0)
+        return NULL;
+
+    if (shine_get_tables() == NULL)
+        return NULL;
+
+    config = (shine_global_config *)calloc(1, sizeof(shine_global_config));
+    if (config == NULL)
+        return config;
+
+    shine_open_bit_stream(&config->bs, BUFFER_SIZE);
+    shine_setup(config, pub_config);
     return config;
 }
 
-static unsigned char *shine_encode_buffer_internal(shine_global_config *config, int *written, int stride) {
+/* Zero all the running state (filter history, granule data, slot lag...) as
+ * calloc did, but keep the bit stream buffer. */
+int shine_reset(shine_global_config *config, shine_config_t *pub_config) {
+    bitstream_t bs;
+    int rate_control;
+
+    if (shine_check_config(pub_config->wave.samplerate, pub_config->mpeg.bitr) < 0)
+        return -1;
+
+    bs = config->bs;
+    rate_control = config->rate_control;
+    memset(config, 0, sizeof(shine_global_config));
+    config->rate_control = rate_control;
+    config->bs.data = bs.data;
+    config->bs.data_size = bs.data_size;
+    config->bs.data_position = 0;
+    config->bs.cache = 0;
+    config->bs.cache_bits = 32;
+
+    shine_setup(config, pub_config);
+    return 0;
+}
+
+/* Decide the padding bit of the next frame and advance the slot lag. */
+static void shine_next_padding(shine_global_config *config) {
     if (config->mpeg.frac_slots_per_frame) {
         config->mpeg.padding = (config->mpeg.slot_lag <= (config->mpeg.frac_slots_per_frame - 1.0));
         config->mpeg.slot_lag += (config->mpeg.padding - config->mpeg.frac_slots_per_frame);
     }
+}
+
+static unsigned char *shine_encode_buffer_internal(shine_global_config *config, int *written, int stride) {
+    shine_next_padding(config);
 
     config->mpeg.bits_per_frame = 8 * (config->mpeg.whole_slots_per_frame + config->mpeg.padding);
     config->mean_bits = (config->mpeg.bits_per_frame - config->sideinfo_len) / config->mpeg.granules_per_frame;
@@ -976,7 +1051,9 @@ static unsigned char *shine_encode_buffer_internal(shine_global_config *config,
     shine_mdct_sub(config, stride);
 
     /* bit and noise allocation */
+    unsigned long long start = EasyMp3StageBegin();
     shine_iteration_loop(config);
+    EasyMp3StageEnd(EASY_MP3_STAGE_ITERATION, start);
 
     /* write the frame to the bitstream */
     shine_format_bitstream(config);
@@ -1005,10 +1082,46 @@ unsigned char *shine_encode_buffer_interleaved(shine_global_config *config, int1
 }
 
 unsigned char *shine_flush(shine_global_config *config, int *written) {
-    *written = config->bs.data_position;
-    config->bs.data_position = 0;
+    bitstream_t *bs = &config->bs;
 
-    return config->bs.data;
+    /* Drain the bits still held in the cache. Frames are a whole number of
+     * bytes, so at a frame boundary the cache only holds whole bytes. */
+    if (bs->data_position + (int)sizeof(unsigned int) >= bs->data_size) {
+        bs->data = (unsigned char *) realloc(bs->data, bs->data_size + (bs->data_size / 2));
+        bs->data_size += (bs->data_size / 2);
+    }
+    for (int bits = 32 - bs->cache_bits; bits > 0; bits -= 8) {
+        bs->data[bs->data_position++] = (unsigned char) (bs->cache >> 24);
+        bs->cache <<= 8;
+    }
+    bs->cache = 0;
+    bs->cache_bits = 32;
+
+    *written = bs->data_position;
+    bs->data_position = 0;
+
+    return bs->data;
+}
+
+double shine_get_slot_lag(shine_global_config *config) {
+    return config->mpeg.slot_lag;
+}
+
+void shine_set_slot_lag(shine_global_config *config, double slot_lag) {
+    config->mpeg.slot_lag = slot_lag;
+}
+
+void shine_skip_frames(shine_global_config *config, int frames) {
+    while (frames-- > 0)
+        shine_next_padding(config);
+}
+
+void shine_set_rate_control(shine_global_config *config, shine_rate_control_t rc) {
+    config->rate_control = rc == SHINE_RC_FAST ? SHINE_RC_FAST : SHINE_RC_DEFAULT;
+}
+
+shine_rate_control_t shine_get_rate_control(shine_global_config *config) {
+    return (shine_rate_control_t) config->rate_control;
 }
 
 
@@ -1409,7 +1522,7 @@ static int count_bit(int ix[GRANULE_SIZE], unsigned int start, unsigned int end,
 
 static int bigv_bitcount(int ix[GRANULE_SIZE], shine_gr_info *gi);
 
-static int new_choose_table(int ix[GRANULE_SIZE], unsigned int begin, unsigned int end);
+static int new_choose_table(int ix[GRANULE_SIZE], unsigned int begin, unsigned int end, int *bits);
 
 static void bigv_tab_select(int ix[GRANULE_SIZE], shine_gr_info *cod_info);
 
@@ -1448,6 +1561,131 @@ int shine_inner_loop(int ix[GRANULE_SIZE],
     return bits;
 }
 
+/*
+ * count_bits_limit:
+ * -----------------
+ * The bit count of shine_inner_loop for the ix of the last quantize, except
+ * that it stops as soon as the count exceeds limit, and the bits of each
+ * region come from the table selection instead of counting them again in
+ * bigv_bitcount. Only the comparison with limit is exact when it stops early.
+ */
+static int count_bits_limit(int ix[GRANULE_SIZE], int limit, shine_gr_info *cod_info, shine_global_config *config) {
+    unsigned int end[3];
+    unsigned int begin = 0;
+    int bits, region, table_bits;
+
+    calc_runlen(ix, cod_info);
+    bits = count1_bitcount(ix, cod_info);
+    if (bits > limit)
+        return bits;
+
+    subdivide(cod_info, config);
+    end[0] = cod_info->address1;
+    end[1] = cod_info->address2;
+    end[2] = cod_info->big_values << 1;
+    for (region = 0; region < 3; region++) {
+        cod_info->table_select[region] = 0;
+        if (end[region] > begin) {
+            cod_info->table_select[region] = new_choose_table(ix, begin, end[region], &table_bits);
+            bits += table_bits;
+            if (bits > limit)
+                return bits;
+        }
+        begin = end[region];
+    }
+    return bits;
+}
+
+/* Whether the granule fits into max_bits at this step size */
+static int fast_fits(int step, int max_bits, int ix[GRANULE_SIZE], shine_gr_info *cod_info,
+                     shine_global_config *config) {
+    if (quantize(ix, step, config) > 8192)
+        return 0;
+    return count_bits_limit(ix, max_bits, cod_info, config) <= max_bits;
+}
+
+/*
+ * fast_search_StepSize:
+ * ---------------------
+ * Smallest step size at which the granule fits into max_bits, searched from
+ * the step size of the previous granule of the channel: move away from it in
+ * steps of 1, 2, 4... until the answer is bracketed, then bisect. The bit
+ * count is close to monotonic in the step size, consecutive granules usually
+ * end up within a step or two of each other, and failed trials stop counting
+ * early, so this takes far fewer full counts than bin_search_StepSize.
+ */
+static int fast_search_StepSize(int start, int max_bits, int ix[GRANULE_SIZE], shine_gr_info *cod_info,
+                                shine_global_config *config) {
+    int lo = -121; /* largest step known not to fit, -121 for none */
+    int hi = 1;    /* smallest step known to fit, 1 for none */
+    int step, delta;
+
+    if (start < -120)
+        start = -120;
+    if (start > 0)
+        start = 0;
+
+    if (fast_fits(start, max_bits, ix, cod_info, config)) {
+        hi = start;
+        for (delta = 1; hi - delta > -121; delta <<= 1) {
+            step = hi - delta;
+            if (!fast_fits(step, max_bits, ix, cod_info, config)) {
+                lo = step;
+                break;
+            }
+            hi = step;
+        }
+    } else {
+        lo = start;
+        for (delta = 1; lo + delta < 1; delta <<= 1) {
+            step = lo + delta;
+            if (fast_fits(step, max_bits, ix, cod_info, config)) {
+                hi = step;
+                break;
+            }
+            lo = step;
+        }
+    }
+
+    while (hi - lo > 1) {
+        step = lo + (hi - lo) / 2;
+        if (fast_fits(step, max_bits, ix, cod_info, config))
+            hi = step;
+        else
+            lo = step;
+    }
+    return hi < 1 ? hi : 0;
+}
+
+/*
+ * fast_outer_loop:
+ * ----------------
+ * shine_outer_loop of SHINE_RC_FAST. The first granule of a channel starts
+ * from bin_search_StepSize, later ones from the previous granule. The search
+ * only picks the step size; shine_inner_loop then quantizes and counts at it
+ * as usual, and steps further up in the rare case that it does not fit.
+ */
+static int fast_outer_loop(int max_bits, int ix[GRANULE_SIZE], int gr, int ch, shine_global_config *config) {
+    shine_gr_info *cod_info = &config->side_info.gr[gr].ch[ch].tt;
+    int start, huff_bits, bits;
+
+    cod_info->part2_length = part2_length(gr, ch, config);
+    huff_bits = max_bits - cod_info->part2_length;
+
+    if (config->last_step_valid[ch])
+        start = config->last_step[ch];
+    else
+        start = bin_search_StepSize(huff_bits, ix, cod_info, config);
+
+    cod_info->quantizerStepSize = fast_search_StepSize(start, huff_bits, ix, cod_info, config) - 1;
+    bits = shine_inner_loop(ix, huff_bits, cod_info, gr, ch, config);
+    cod_info->part2_3_length = cod_info->part2_length + bits;
+
+    config->last_step[ch] = cod_info->quantizerStepSize;
+    config->last_step_valid[ch] = 1;
+    return cod_info->part2_3_length;
+}
+
 /*
  * shine_outer_loop:
  * -----------
@@ -1464,6 +1702,9 @@ int shine_outer_loop(int max_bits,
     shine_side_info_t *side_info = &config->side_info;
     shine_gr_info *cod_info = &side_info->gr[gr].ch[ch].tt;
 
+    if (config->rate_control == SHINE_RC_FAST)
+        return fast_outer_loop(max_bits, ix, gr, ch, config);
+
     cod_info->quantizerStepSize = bin_search_StepSize(max_bits, ix, cod_info, config);
 
     cod_info->part2_length = part2_length(gr, ch, config);
@@ -1709,12 +1950,34 @@ void calc_xmin(shine_psy_ratio_t *ratio,
     }
 }
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(SHINE_NO_SIMD)
+#define SHINE_X86_SIMD 1
+#include <immintrin.h>
+
+/* Every lane computes mul(a, b) of the generic path: the high 32 bits of the
+ * signed 64-bit product. Lanes are summed with 32-bit wrap-around additions
+ * just like the scalar `muladd`, so the SIMD kernels are bit-exact with it. */
+__attribute__((target("sse4.1")))
+static inline __m128i shine_mul_sse41(__m128i a, __m128i b) {
+    __m128i even = _mm_srli_epi64(_mm_mul_epi32(a, b), 32);
+    __m128i odd = _mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_blend_epi16(even, odd, 0xcc);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i shine_mul_avx2(__m256i a, __m256i b) {
+    __m256i even = _mm256_srli_epi64(_mm256_mul_epi32(a, b), 32);
+    __m256i odd = _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+    return _mm256_blend_epi32(even, odd, 0xaa);
+}
+#endif
+
 /*
- * shine_loop_initialise:
+ * shine_loop_tables:
  * -------------------
  * Calculates the look up tables used by the iteration loop.
  */
-void shine_loop_initialise(shine_global_config *config) {
+void shine_loop_tables(shine_tables_t *tab) {
     int i;
 
     /* quantize: stepsize conversion, fourth root of 2 table.
@@ -1723,64 +1986,152 @@ void shine_loop_initialise(shine_global_config *config) {
      * The 0.5 is for rounding.
      */
     for (i = 128; i--;) {
-        config->l3loop.steptab[i] = pow(2.0, (double) (127 - i) / 4);
-        if ((config->l3loop.steptab[i] * 2) > 0x7fffffff) /* MAXINT = 2**31 = 2**(124/4) */
-            config->l3loop.steptabi[i] = 0x7fffffff;
+        tab->steptab[i] = pow(2.0, (double) (127 - i) / 4);
+        if ((tab->steptab[i] * 2) > 0x7fffffff) /* MAXINT = 2**31 = 2**(124/4) */
+            tab->steptabi[i] = 0x7fffffff;
         else
             /* The table is multiplied by 2 to give an extra bit of accuracy.
              * In quantize, the long multiply does not shift it's result left one
              * bit to compensate.
              */
-            config->l3loop.steptabi[i] = (int32_t) ((config->l3loop.steptab[i] * 2) + 0.5);
+            tab->steptabi[i] = (int32_t) ((tab->steptab[i] * 2) + 0.5);
     }
 
     /* quantize: vector conversion, three quarter power table.
      * The 0.5 is for rounding, the .0946 comes from the spec.
      */
     for (i = 10000; i--;)
-        config->l3loop.int2idx[i] = (int) (sqrt(sqrt((double) i) * (double) i) - 0.0946 + 0.5);
+        tab->int2idx[i] = (int) (sqrt(sqrt((double) i) * (double) i) - 0.0946 + 0.5);
+
+    memset(tab->hlen, 0, sizeof(tab->hlen));
+    for (i = 0; i < 32; i++) {
+        const struct huffcodetab *h = &shine_huffman_table[i];
+        unsigned int j;
+        for (j = 0; h->hlen && j < h->xlen * h->ylen; j++)
+            tab->hlen[i][j] = h->hlen[j];
+    }
+}
+
+void shine_loop_initialise(shine_global_config *config) {
+    const shine_tables_t *tab = shine_get_tables();
+
+    config->l3loop.steptab = tab->steptab;
+    config->l3loop.steptabi = tab->steptabi;
+    config->l3loop.int2idx = tab->int2idx;
+}
+
+/* ix for a value outside the int2idx table, done using floats */
+static inline int quantize_float(int32_t xrabs, int stepsize, shine_global_config *config) {
+    double scale = config->l3loop.steptab[stepsize + 127]; /* 2**(-stepsize/4) */
+    double dbl = ((double) xrabs) * scale * 4.656612875e-10; /* 0x7fffffff */
+    return (int) sqrt(sqrt(dbl) * dbl); /* dbl**(3/4) */
+}
+
+static int quantize_c(int ix[GRANULE_SIZE], int stepsize, shine_global_config *config) {
+    int i, max, ln;
+    int32_t scalei = config->l3loop.steptabi[stepsize + 127]; /* 2**(-stepsize/4) */
+
+    for (i = 0, max = 0; i < GRANULE_SIZE; i++) {
+        /* This calculation is very sensitive. The multiply must round it's
+         * result or bad things happen to the quality.
+         */
+        ln = mulr(labs(config->l3loop.xr[i]), scalei);
+
+        if (ln < 10000) /* ln < 10000 catches most values */
+            ix[i] = config->l3loop.int2idx[ln]; /* quick look up method */
+        else
+            ix[i] = quantize_float(config->l3loop.xrabs[i], stepsize, config);
+
+        /* calculate ixmax while we're here */
+        /* note. ix cannot be negative */
+        if (max < ix[i])
+            max = ix[i];
+    }
+    return max;
+}
+
+#ifdef SHINE_X86_SIMD
+/* Both operands of the rounding multiply are non-negative, so it is done
+ * unsigned: xrabs holds labs(xr) and the one value that does not fit,
+ * labs(INT32_MIN), reads back as 2**31 just like the long in quantize_c. */
+__attribute__((target("avx2")))
+static inline __m256i shine_mulr_avx2(__m256i a, __m256i b) {
+    const __m256i round = _mm256_set1_epi64x(0x80000000LL);
+    __m256i even = _mm256_srli_epi64(_mm256_add_epi64(_mm256_mul_epu32(a, b), round), 32);
+    __m256i odd = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b), round);
+    return _mm256_blend_epi32(even, odd, 0xaa);
+}
+
+__attribute__((target("sse4.1")))
+static inline int shine_hmax_sse41(__m128i v) {
+    v = _mm_max_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_max_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(v);
+}
+
+__attribute__((target("avx2")))
+static inline int shine_hmax_avx2(__m256i v) {
+    return shine_hmax_sse41(_mm_max_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+}
+
+__attribute__((target("sse4.1")))
+static inline int shine_hsum_sse41(__m128i v) {
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(v);
+}
+
+/* Lanes outside the table gather a clamped index and are patched afterwards */
+__attribute__((target("avx2")))
+static int quantize_avx2(int ix[GRANULE_SIZE], int stepsize, shine_global_config *config) {
+    const int *int2idx = config->l3loop.int2idx;
+    __m256i scalei = _mm256_set1_epi32(config->l3loop.steptabi[stepsize + 127]);
+    __m256i last = _mm256_set1_epi32(10000 - 1);
+    __m256i vmax = _mm256_setzero_si256();
+    int i;
+
+    for (i = 0; i < GRANULE_SIZE; i += 8) {
+        __m256i ln = shine_mulr_avx2(_mm256_loadu_si256((const __m256i *) &config->l3loop.xrabs[i]), scalei);
+        __m256i v = _mm256_i32gather_epi32(int2idx, _mm256_min_epi32(ln, last), 4);
+        int outside = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(ln, last)));
+
+        _mm256_storeu_si256((__m256i *) &ix[i], v);
+        if (outside) {
+            int k;
+            for (k = 0; k < 8; k++)
+                if (outside & (1 << k))
+                    ix[i + k] = quantize_float(config->l3loop.xrabs[i + k], stepsize, config);
+            v = _mm256_loadu_si256((const __m256i *) &ix[i]);
+        }
+        vmax = _mm256_max_epi32(vmax, v);
+    }
+    return shine_hmax_avx2(vmax);
 }
+#endif
 
 /*
  * quantize:
  * ---------
  * Function: Quantization of the vector xr ( -> ix).
  * Returns maximum value of ix.
+ * Only AVX2 has a gather for the int2idx look ups; with SSE4.1 alone the
+ * scalar look ups made a vector version slower than quantize_c, so the
+ * whole iteration loop (quantize, ix_max, calc_runlen) uses the C code there.
  */
 int quantize(int ix[GRANULE_SIZE], int stepsize, shine_global_config *config) {
-    int i, max, ln;
-    int32_t scalei;
-    double scale, dbl;
-
-    scalei = config->l3loop.steptabi[stepsize + 127]; /* 2**(-stepsize/4) */
-
     /* a quick check to see if ixmax will be less than 8192 */
     /* this speeds up the early calls to bin_search_StepSize */
-    if ((mulr(config->l3loop.xrmax, scalei)) > 165140) /* 8192**(4/3) */
-        max = 16384; /* no point in continuing, stepsize not big enough */
-    else
-        for (i = 0, max = 0; i < GRANULE_SIZE; i++) {
-            /* This calculation is very sensitive. The multiply must round it's
-             * result or bad things happen to the quality.
-             */
-            ln = mulr(labs(config->l3loop.xr[i]), scalei);
-
-            if (ln < 10000) /* ln < 10000 catches most values */
-                ix[i] = config->l3loop.int2idx[ln]; /* quick look up method */
-            else {
-                /* outside table range so have to do it using floats */
-                scale = config->l3loop.steptab[stepsize + 127]; /* 2**(-stepsize/4) */
-                dbl = ((double) config->l3loop.xrabs[i]) * scale * 4.656612875e-10; /* 0x7fffffff */
-                ix[i] = (int) sqrt(sqrt(dbl) * dbl); /* dbl**(3/4) */
-            }
+    if ((mulr(config->l3loop.xrmax, config->l3loop.steptabi[stepsize + 127])) > 165140) /* 8192**(4/3) */
+        return 16384; /* no point in continuing, stepsize not big enough */
 
-            /* calculate ixmax while we're here */
-            /* note. ix cannot be negative */
-            if (max < ix[i])
-                max = ix[i];
-        }
-
-    return max;
+    switch (shine_get_simd()) {
+#ifdef SHINE_X86_SIMD
+        case SHINE_SIMD_AVX2:
+            return quantize_avx2(ix, stepsize, config);
+#endif
+        default:
+            return quantize_c(ix, stepsize, config);
+    }
 }
 
 /*
@@ -1788,7 +2139,7 @@ int quantize(int ix[GRANULE_SIZE], int stepsize, shine_global_config *config) {
  * -------
  * Function: Calculate the maximum of ix from 0 to 575
  */
-static inline int ix_max(int ix[GRANULE_SIZE], unsigned int begin, unsigned int end) {
+static inline int ix_max_c(int ix[GRANULE_SIZE], unsigned int begin, unsigned int end) {
     register int i;
     register int max = 0;
 
@@ -1798,6 +2149,60 @@ static inline int ix_max(int ix[GRANULE_SIZE], unsigned int begin, unsigned int
     return max;
 }
 
+#ifdef SHINE_X86_SIMD
+__attribute__((target("avx2")))
+static int ix_max_avx2(int ix[GRANULE_SIZE], unsigned int begin, unsigned int end) {
+    __m256i vmax = _mm256_setzero_si256();
+    unsigned int i;
+    int max;
+
+    for (i = begin; i + 8 <= end; i += 8)
+        vmax = _mm256_max_epi32(vmax, _mm256_loadu_si256((const __m256i *) &ix[i]));
+    max = shine_hmax_avx2(vmax);
+    for (; i < end; i++)
+        if (max < ix[i])
+            max = ix[i];
+    return max;
+}
+#endif
+
+static int ix_max(int ix[GRANULE_SIZE], unsigned int begin, unsigned int end) {
+    switch (shine_get_simd()) {
+#ifdef SHINE_X86_SIMD
+        case SHINE_SIMD_AVX2:
+            return ix_max_avx2(ix, begin, end);
+#endif
+        default:
+            return ix_max_c(ix, begin, end);
+    }
+}
+
+#ifdef SHINE_X86_SIMD
+__attribute__((target("avx2")))
+static int calc_runlen_zero_avx2(const int ix[GRANULE_SIZE], int i) {
+    while (i >= 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) &ix[i - 8]);
+        if (!_mm256_testz_si256(v, v))
+            break;
+        i -= 8;
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static int calc_runlen_count1_avx2(const int ix[GRANULE_SIZE], int i, unsigned *count1) {
+    const __m256i one = _mm256_set1_epi32(1);
+    while (i >= 8) {
+        __m256i big = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *) &ix[i - 8]), one);
+        if (!_mm256_testz_si256(big, big))
+            break;
+        i -= 8;
+        *count1 += 2;
+    }
+    return i;
+}
+#endif
+
 /*
  * calc_runlen:
  * ------------
@@ -1805,16 +2210,28 @@ static inline int ix_max(int ix[GRANULE_SIZE], unsigned int begin, unsigned int
  * (Partitions ix into big values, quadruples and zeros).
  */
 void calc_runlen(int ix[GRANULE_SIZE], shine_gr_info *cod_info) {
-    int i;
+    int i = GRANULE_SIZE;
     int rzero = 0;
-
-    for (i = GRANULE_SIZE; i > 1; i -= 2)
+    shine_simd_t simd = shine_get_simd();
+
+    /* The SIMD paths skip whole vectors of zeros (and then of values <= 1)
+     * from the top; i stays even, so the scalar loops below finish exactly
+     * where they would have stopped on their own. */
+#ifdef SHINE_X86_SIMD
+    if (simd == SHINE_SIMD_AVX2)
+        i = calc_runlen_zero_avx2(ix, i);
+#endif
+    for (; i > 1; i -= 2)
         if (!ix[i - 1] && !ix[i - 2])
             rzero++;
         else
             break;
 
     cod_info->count1 = 0;
+#ifdef SHINE_X86_SIMD
+    if (simd == SHINE_SIMD_AVX2)
+        i = calc_runlen_count1_avx2(ix, i, &cod_info->count1);
+#endif
     for (; i > 3; i -= 4)
         if (ix[i - 1] <= 1
             && ix[i - 2] <= 1
@@ -1950,13 +2367,13 @@ void bigv_tab_select(int ix[GRANULE_SIZE], shine_gr_info *cod_info) {
 
     {
         if (cod_info->address1 > 0)
-            cod_info->table_select[0] = new_choose_table(ix, 0, cod_info->address1);
+            cod_info->table_select[0] = new_choose_table(ix, 0, cod_info->address1, NULL);
 
         if (cod_info->address2 > cod_info->address1)
-            cod_info->table_select[1] = new_choose_table(ix, cod_info->address1, cod_info->address2);
+            cod_info->table_select[1] = new_choose_table(ix, cod_info->address1, cod_info->address2, NULL);
 
         if (cod_info->big_values << 1 > cod_info->address2)
-            cod_info->table_select[2] = new_choose_table(ix, cod_info->address2, cod_info->big_values << 1);
+            cod_info->table_select[2] = new_choose_table(ix, cod_info->address2, cod_info->big_values << 1, NULL);
     }
 }
 
@@ -1968,12 +2385,17 @@ void bigv_tab_select(int ix[GRANULE_SIZE], shine_gr_info *cod_info) {
  * Note: This code contains knowledge about the sizes and characteristics
  * of the Huffman tables as defined in the IS (Table B.7), and will not work
  * with any arbitrary tables.
+ * bits: if not NULL, receives the count_bit of the chosen table, which is
+ * computed here anyway.
  */
-int new_choose_table(int ix[GRANULE_SIZE], unsigned int begin, unsigned int end) {
+int new_choose_table(int ix[GRANULE_SIZE], unsigned int begin, unsigned int end, int *bits) {
     int i, max;
     int choice[2];
     int sum[2];
 
+    if (bits)
+        *bits = 0;
+
     max = ix_max(ix, begin, end);
     if (!max)
         return 0;
@@ -1994,14 +2416,18 @@ int new_choose_table(int ix[GRANULE_SIZE], unsigned int begin, unsigned int end)
         switch (choice[0]) {
             case 2:
                 sum[1] = count_bit(ix, begin, end, 3);
-                if (sum[1] <= sum[0])
+                if (sum[1] <= sum[0]) {
                     choice[0] = 3;
+                    sum[0] = sum[1];
+                }
                 break;
 
             case 5:
                 sum[1] = count_bit(ix, begin, end, 6);
-                if (sum[1] <= sum[0])
+                if (sum[1] <= sum[0]) {
                     choice[0] = 6;
+                    sum[0] = sum[1];
+                }
                 break;
 
             case 7:
@@ -2011,8 +2437,10 @@ int new_choose_table(int ix[GRANULE_SIZE], unsigned int begin, unsigned int end)
                     sum[0] = sum[1];
                 }
                 sum[1] = count_bit(ix, begin, end, 9);
-                if (sum[1] <= sum[0])
+                if (sum[1] <= sum[0]) {
                     choice[0] = 9;
+                    sum[0] = sum[1];
+                }
                 break;
 
             case 10:
@@ -2022,14 +2450,18 @@ int new_choose_table(int ix[GRANULE_SIZE], unsigned int begin, unsigned int end)
                     sum[0] = sum[1];
                 }
                 sum[1] = count_bit(ix, begin, end, 12);
-                if (sum[1] <= sum[0])
+                if (sum[1] <= sum[0]) {
                     choice[0] = 12;
+                    sum[0] = sum[1];
+                }
                 break;
 
             case 13:
                 sum[1] = count_bit(ix, begin, end, 15);
-                if (sum[1] <= sum[0])
+                if (sum[1] <= sum[0]) {
                     choice[0] = 15;
+                    sum[0] = sum[1];
+                }
                 break;
         }
     } else {
@@ -2050,9 +2482,14 @@ int new_choose_table(int ix[GRANULE_SIZE], unsigned int begin, unsigned int end)
 
         sum[0] = count_bit(ix, begin, end, choice[0]);
         sum[1] = count_bit(ix, begin, end, choice[1]);
-        if (sum[1] < sum[0])
+        if (sum[1] < sum[0]) {
             choice[0] = choice[1];
+            sum[0] = sum[1];
+        }
     }
+
+    if (bits)
+        *bits = sum[0];
     return choice[0];
 }
 
@@ -2079,18 +2516,15 @@ int bigv_bitcount(int ix[GRANULE_SIZE], shine_gr_info *gi) {
  * ----------
  * Function: Count the number of bits necessary to code the subregion.
  */
-int count_bit(int ix[GRANULE_SIZE],
-              unsigned int start,
-              unsigned int end,
-              unsigned int table) {
+static int count_bit_c(int ix[GRANULE_SIZE],
+                       unsigned int start,
+                       unsigned int end,
+                       unsigned int table) {
     unsigned linbits, ylen;
     register int i, sum;
     register int x, y;
     const struct huffcodetab *h;
 
-    if (!table)
-        return 0;
-
     h = &(shine_huffman_table[table]);
     sum = 0;
 
@@ -2132,6 +2566,64 @@ int count_bit(int ix[GRANULE_SIZE],
     return sum;
 }
 
+#ifdef SHINE_X86_SIMD
+/* Four (x, y) pairs per step. x * ylen + y is formed in the low half of each
+ * 64-bit lane and the code lengths are gathered from the 32-bit copy of the
+ * table. Values above 14 only occur with the ESC tables (table > 15), where
+ * they are clamped to 15 and cost linbits extra, as in count_bit_c. */
+__attribute__((target("avx2")))
+static int count_bit_avx2(int ix[GRANULE_SIZE], unsigned int start, unsigned int end, unsigned int table,
+                          const int32_t *hlen) {
+    const struct huffcodetab *h = &shine_huffman_table[table];
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i fourteen = _mm256_set1_epi32(14);
+    const __m256i fifteen = _mm256_set1_epi32(15);
+    const __m256i linbits = _mm256_set1_epi32(h->linbits);
+    const __m256i ylen = _mm256_setr_epi32(h->ylen, 1, h->ylen, 1, h->ylen, 1, h->ylen, 1);
+    const __m256i low = _mm256_set1_epi64x(0xffffffffLL);
+    __m256i extra = _mm256_setzero_si256(); /* sign bits and linbits */
+    __m128i lens = _mm_setzero_si128();
+    unsigned int i;
+    int sum;
+
+    for (i = start; i + 8 <= end; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) &ix[i]);
+        __m256i idx;
+
+        extra = _mm256_add_epi32(extra, _mm256_andnot_si256(_mm256_cmpeq_epi32(v, zero), one));
+        if (table > 15) {
+            extra = _mm256_add_epi32(extra, _mm256_and_si256(_mm256_cmpgt_epi32(v, fourteen), linbits));
+            v = _mm256_min_epi32(v, fifteen);
+        }
+        idx = _mm256_mullo_epi32(v, ylen);
+        idx = _mm256_and_si256(_mm256_add_epi32(idx, _mm256_srli_epi64(idx, 32)), low);
+        lens = _mm_add_epi32(lens, _mm256_i64gather_epi32(hlen, idx, 4));
+    }
+
+    sum = shine_hsum_sse41(_mm_add_epi32(lens, _mm_add_epi32(_mm256_castsi256_si128(extra),
+                                                             _mm256_extracti128_si256(extra, 1))));
+    if (i < end)
+        sum += count_bit_c(ix, i, end, table);
+    return sum;
+}
+#endif
+
+/* SSE4.1 has no gather and gains nothing over the C code here */
+int count_bit(int ix[GRANULE_SIZE],
+              unsigned int start,
+              unsigned int end,
+              unsigned int table) {
+    if (!table)
+        return 0;
+
+#ifdef SHINE_X86_SIMD
+    if (shine_get_simd() == SHINE_SIMD_AVX2)
+        return count_bit_avx2(ix, start, end, table, shine_get_tables()->hlen[table]);
+#endif
+    return count_bit_c(ix, start, end, table);
+}
+
 /*
  * bin_search_StepSize:
  * --------------------
@@ -2198,10 +2690,10 @@ int bin_search_StepSize(int desired_rate, int ix[GRANULE_SIZE],
 #define MDCT_CS7    MDCT_CS(-0.0037)
 
 /*
- * shine_mdct_initialise:
+ * shine_mdct_tables:
  * -------------------
  */
-void shine_mdct_initialise(shine_global_config *config) {
+void shine_mdct_tables(shine_tables_t *tab) {
     int m, k;
 
     /* prepare the mdct coefficients */
@@ -2209,8 +2701,202 @@ void shine_mdct_initialise(shine_global_config *config) {
         for (k = 36; k--;)
             /* combine window and mdct coefficients into a single table */
             /* scale and convert to fixed point before storing */
-            config->mdct.cos_l[m][k] = (int32_t) (sin(PI36 * (k + 0.5))
+            tab->cos_l[m][k] = (int32_t) (sin(PI36 * (k + 0.5))
                                                   * cos((PI / 72) * (2 * k + 19) * (2 * m + 1)) * 0x7fffffff);
+
+    memset(tab->cos_t, 0, sizeof(tab->cos_t));
+    for (m = 18; m--;)
+        for (k = 36; k--;)
+            tab->cos_t[k][m] = tab->cos_l[m][k];
+}
+
+void shine_mdct_initialise(shine_global_config *config) {
+    const shine_tables_t *tab = shine_get_tables();
+
+    config->mdct.cos_l = tab->cos_l;
+    config->mdct.cos_t = tab->cos_t;
+}
+
+/*
+ * shine_mdct_band:
+ * ------------
+ * Calculation of the MDCT
+ * In the case of long blocks ( block_type 0,1,3 ) there are
+ * 36 coefficients in the time domain and 18 in the frequency
+ * domain.
+ */
+static void shine_mdct_band_c(const int32_t mdct_in[36], const int32_t cos_l[18][36], int32_t out[18]) {
+    int j, k;
+
+    for (k = 18; k--;) {
+        int32_t vm;
+        uint32_t vm_lo __attribute__((unused));
+
+        mul0(vm, vm_lo, mdct_in[35], cos_l[k][35]);
+        for (j = 35; j; j -= 7) {
+            muladd(vm, vm_lo, mdct_in[j - 1], cos_l[k][j - 1]);
+            muladd(vm, vm_lo, mdct_in[j - 2], cos_l[k][j - 2]);
+            muladd(vm, vm_lo, mdct_in[j - 3], cos_l[k][j - 3]);
+            muladd(vm, vm_lo, mdct_in[j - 4], cos_l[k][j - 4]);
+            muladd(vm, vm_lo, mdct_in[j - 5], cos_l[k][j - 5]);
+            muladd(vm, vm_lo, mdct_in[j - 6], cos_l[k][j - 6]);
+            muladd(vm, vm_lo, mdct_in[j - 7], cos_l[k][j - 7]);
+        }
+        mulz(vm, vm_lo);
+        out[k] = vm;
+    }
+}
+
+static void shine_mdct_alias_c(int32_t (*mdct_enc)[18]) {
+    int band;
+
+    for (band = 1; band < 32; band++) {
+        cmuls(mdct_enc[band][0], mdct_enc[band - 1][17 - 0], mdct_enc[band][0], mdct_enc[band - 1][17 - 0],
+              MDCT_CS0, MDCT_CA0);
+        cmuls(mdct_enc[band][1], mdct_enc[band - 1][17 - 1], mdct_enc[band][1], mdct_enc[band - 1][17 - 1],
+              MDCT_CS1, MDCT_CA1);
+        cmuls(mdct_enc[band][2], mdct_enc[band - 1][17 - 2], mdct_enc[band][2], mdct_enc[band - 1][17 - 2],
+              MDCT_CS2, MDCT_CA2);
+        cmuls(mdct_enc[band][3], mdct_enc[band - 1][17 - 3], mdct_enc[band][3], mdct_enc[band - 1][17 - 3],
+              MDCT_CS3, MDCT_CA3);
+        cmuls(mdct_enc[band][4], mdct_enc[band - 1][17 - 4], mdct_enc[band][4], mdct_enc[band - 1][17 - 4],
+              MDCT_CS4, MDCT_CA4);
+        cmuls(mdct_enc[band][5], mdct_enc[band - 1][17 - 5], mdct_enc[band][5], mdct_enc[band - 1][17 - 5],
+              MDCT_CS5, MDCT_CA5);
+        cmuls(mdct_enc[band][6], mdct_enc[band - 1][17 - 6], mdct_enc[band][6], mdct_enc[band - 1][17 - 6],
+              MDCT_CS6, MDCT_CA6);
+        cmuls(mdct_enc[band][7], mdct_enc[band - 1][17 - 7], mdct_enc[band][7], mdct_enc[band - 1][17 - 7],
+              MDCT_CS7, MDCT_CA7);
+    }
+}
+
+#ifdef SHINE_X86_SIMD
+static const int32_t shine_mdct_cs[8] = {MDCT_CS0, MDCT_CS1, MDCT_CS2, MDCT_CS3,
+                                         MDCT_CS4, MDCT_CS5, MDCT_CS6, MDCT_CS7};
+static const int32_t shine_mdct_ca[8] = {MDCT_CA0, MDCT_CA1, MDCT_CA2, MDCT_CA3,
+                                         MDCT_CA4, MDCT_CA5, MDCT_CA6, MDCT_CA7};
+
+/* The 18 outputs are computed in parallel against the transposed table:
+ * out[0..17] += mul(in[j], cos_t[j][0..17]) for every j. */
+__attribute__((target("sse4.1")))
+static void shine_mdct_band_sse41(const int32_t mdct_in[36], const int32_t cos_t[36][24], int32_t out[18]) {
+    __m128i acc[5];
+    int j, k;
+
+    for (k = 0; k < 5; k++)
+        acc[k] = _mm_setzero_si128();
+    for (j = 0; j < 36; j++) {
+        __m128i in = _mm_set1_epi32(mdct_in[j]);
+        for (k = 0; k < 5; k++)
+            acc[k] = _mm_add_epi32(acc[k], shine_mul_sse41(in, _mm_loadu_si128((const __m128i *) &cos_t[j][k << 2])));
+    }
+    for (k = 0; k < 4; k++)
+        _mm_storeu_si128((__m128i *) &out[k << 2], acc[k]);
+    _mm_storel_epi64((__m128i *) &out[16], acc[4]);
+}
+
+/* cmuls() on 4 lanes: the 64-bit sums are shifted right by 31 and truncated,
+ * the low 32 bits of a logical shift are the same as of an arithmetic one. */
+__attribute__((target("sse4.1")))
+static inline void shine_cmuls_sse41(__m128i &re, __m128i &im, __m128i bre, __m128i bim) {
+    __m128i re_odd = _mm_srli_epi64(re, 32), im_odd = _mm_srli_epi64(im, 32);
+    __m128i bre_odd = _mm_srli_epi64(bre, 32), bim_odd = _mm_srli_epi64(bim, 32);
+    __m128i dre_even = _mm_srli_epi64(_mm_sub_epi64(_mm_mul_epi32(re, bre), _mm_mul_epi32(im, bim)), 31);
+    __m128i dre_odd = _mm_slli_epi64(_mm_sub_epi64(_mm_mul_epi32(re_odd, bre_odd), _mm_mul_epi32(im_odd, bim_odd)), 1);
+    __m128i dim_even = _mm_srli_epi64(_mm_add_epi64(_mm_mul_epi32(re, bim), _mm_mul_epi32(im, bre)), 31);
+    __m128i dim_odd = _mm_slli_epi64(_mm_add_epi64(_mm_mul_epi32(re_odd, bim_odd), _mm_mul_epi32(im_odd, bre_odd)), 1);
+    re = _mm_blend_epi16(dre_even, dre_odd, 0xcc);
+    im = _mm_blend_epi16(dim_even, dim_odd, 0xcc);
+}
+
+__attribute__((target("sse4.1")))
+static void shine_mdct_alias_sse41(int32_t (*mdct_enc)[18]) {
+    int band, h;
+
+    for (band = 1; band < 32; band++) {
+        for (h = 0; h < 8; h += 4) {
+            /* lanes are i = h..h+3, the partner of i is 17 - i in the band below */
+            __m128i re = _mm_loadu_si128((const __m128i *) &mdct_enc[band][h]);
+            __m128i im = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &mdct_enc[band - 1][14 - h]), 0x1b);
+            shine_cmuls_sse41(re, im, _mm_loadu_si128((const __m128i *) &shine_mdct_cs[h]),
+                              _mm_loadu_si128((const __m128i *) &shine_mdct_ca[h]));
+            _mm_storeu_si128((__m128i *) &mdct_enc[band][h], re);
+            _mm_storeu_si128((__m128i *) &mdct_enc[band - 1][14 - h], _mm_shuffle_epi32(im, 0x1b));
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void shine_mdct_band_avx2(const int32_t mdct_in[36], const int32_t cos_t[36][24], int32_t out[18]) {
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256(), acc2 = _mm256_setzero_si256();
+    int j;
+
+    for (j = 0; j < 36; j++) {
+        __m256i in = _mm256_set1_epi32(mdct_in[j]);
+        acc0 = _mm256_add_epi32(acc0, shine_mul_avx2(in, _mm256_loadu_si256((const __m256i *) &cos_t[j][0])));
+        acc1 = _mm256_add_epi32(acc1, shine_mul_avx2(in, _mm256_loadu_si256((const __m256i *) &cos_t[j][8])));
+        acc2 = _mm256_add_epi32(acc2, shine_mul_avx2(in, _mm256_loadu_si256((const __m256i *) &cos_t[j][16])));
+    }
+    _mm256_storeu_si256((__m256i *) &out[0], acc0);
+    _mm256_storeu_si256((__m256i *) &out[8], acc1);
+    _mm_storel_epi64((__m128i *) &out[16], _mm256_castsi256_si128(acc2));
+}
+
+__attribute__((target("avx2")))
+static void shine_mdct_alias_avx2(int32_t (*mdct_enc)[18]) {
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i bre = _mm256_loadu_si256((const __m256i *) shine_mdct_cs);
+    const __m256i bim = _mm256_loadu_si256((const __m256i *) shine_mdct_ca);
+    const __m256i bre_odd = _mm256_srli_epi64(bre, 32), bim_odd = _mm256_srli_epi64(bim, 32);
+    int band;
+
+    for (band = 1; band < 32; band++) {
+        __m256i re = _mm256_loadu_si256((const __m256i *) &mdct_enc[band][0]);
+        __m256i im = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *) &mdct_enc[band - 1][10]), reverse);
+        __m256i re_odd = _mm256_srli_epi64(re, 32), im_odd = _mm256_srli_epi64(im, 32);
+        __m256i dre_even = _mm256_srli_epi64(_mm256_sub_epi64(_mm256_mul_epi32(re, bre), _mm256_mul_epi32(im, bim)), 31);
+        __m256i dre_odd = _mm256_slli_epi64(
+                _mm256_sub_epi64(_mm256_mul_epi32(re_odd, bre_odd), _mm256_mul_epi32(im_odd, bim_odd)), 1);
+        __m256i dim_even = _mm256_srli_epi64(_mm256_add_epi64(_mm256_mul_epi32(re, bim), _mm256_mul_epi32(im, bre)), 31);
+        __m256i dim_odd = _mm256_slli_epi64(
+                _mm256_add_epi64(_mm256_mul_epi32(re_odd, bim_odd), _mm256_mul_epi32(im_odd, bre_odd)), 1);
+        _mm256_storeu_si256((__m256i *) &mdct_enc[band][0], _mm256_blend_epi32(dre_even, dre_odd, 0xaa));
+        _mm256_storeu_si256((__m256i *) &mdct_enc[band - 1][10],
+                            _mm256_permutevar8x32_epi32(_mm256_blend_epi32(dim_even, dim_odd, 0xaa), reverse));
+    }
+}
+#endif
+
+static void shine_mdct_band(const int32_t mdct_in[36], mdct_t *mdct, int32_t out[18], shine_simd_t simd) {
+    switch (simd) {
+#ifdef SHINE_X86_SIMD
+        case SHINE_SIMD_AVX2:
+            shine_mdct_band_avx2(mdct_in, mdct->cos_t, out);
+            break;
+        case SHINE_SIMD_SSE41:
+            shine_mdct_band_sse41(mdct_in, mdct->cos_t, out);
+            break;
+#endif
+        default:
+            shine_mdct_band_c(mdct_in, mdct->cos_l, out);
+            break;
+    }
+}
+
+static void shine_mdct_alias(int32_t (*mdct_enc)[18], shine_simd_t simd) {
+    switch (simd) {
+#ifdef SHINE_X86_SIMD
+        case SHINE_SIMD_AVX2:
+            shine_mdct_alias_avx2(mdct_enc);
+            break;
+        case SHINE_SIMD_SSE41:
+            shine_mdct_alias_sse41(mdct_enc);
+            break;
+#endif
+        default:
+            shine_mdct_alias_c(mdct_enc);
+            break;
+    }
 }
 
 /*
@@ -2223,8 +2909,9 @@ void shine_mdct_sub(shine_global_config *config, int stride) {
      */
     int32_t (*mdct_enc)[18];
 
-    int ch, gr, band, j, k;
+    int ch, gr, band, k;
     int32_t mdct_in[36];
+    shine_simd_t simd = shine_get_simd();
 
     for (ch = config->wave.channels; ch--;) {
         for (gr = 0; gr < config->mpeg.granules_per_frame; gr++) {
@@ -2251,49 +2938,13 @@ void shine_mdct_sub(shine_global_config *config, int stride) {
                     mdct_in[k + 18] = config->l3_sb_sample[ch][gr + 1][k][band];
                 }
 
-                /* Calculation of the MDCT
-                 * In the case of long blocks ( block_type 0,1,3 ) there are
-                 * 36 coefficients in the time domain and 18 in the frequency
-                 * domain.
-                 */
-                for (k = 18; k--;) {
-                    int32_t vm;
-                    uint32_t vm_lo __attribute__((unused));
-
-                    mul0(vm, vm_lo, mdct_in[35], config->mdct.cos_l[k][35]);
-                    for (j = 35; j; j -= 7) {
-                        muladd(vm, vm_lo, mdct_in[j - 1], config->mdct.cos_l[k][j - 1]);
-                        muladd(vm, vm_lo, mdct_in[j - 2], config->mdct.cos_l[k][j - 2]);
-                        muladd(vm, vm_lo, mdct_in[j - 3], config->mdct.cos_l[k][j - 3]);
-                        muladd(vm, vm_lo, mdct_in[j - 4], config->mdct.cos_l[k][j - 4]);
-                        muladd(vm, vm_lo, mdct_in[j - 5], config->mdct.cos_l[k][j - 5]);
-                        muladd(vm, vm_lo, mdct_in[j - 6], config->mdct.cos_l[k][j - 6]);
-                        muladd(vm, vm_lo, mdct_in[j - 7], config->mdct.cos_l[k][j - 7]);
-                    }
-                    mulz(vm, vm_lo);
-                    mdct_enc[band][k] = vm;
-                }
-
-                /* Perform aliasing reduction butterfly */
-                if (band != 0) {
-                    cmuls(mdct_enc[band][0], mdct_enc[band - 1][17 - 0], mdct_enc[band][0], mdct_enc[band - 1][17 - 0],
-                          MDCT_CS0, MDCT_CA0);
-                    cmuls(mdct_enc[band][1], mdct_enc[band - 1][17 - 1], mdct_enc[band][1], mdct_enc[band - 1][17 - 1],
-                          MDCT_CS1, MDCT_CA1);
-                    cmuls(mdct_enc[band][2], mdct_enc[band - 1][17 - 2], mdct_enc[band][2], mdct_enc[band - 1][17 - 2],
-                          MDCT_CS2, MDCT_CA2);
-                    cmuls(mdct_enc[band][3], mdct_enc[band - 1][17 - 3], mdct_enc[band][3], mdct_enc[band - 1][17 - 3],
-                          MDCT_CS3, MDCT_CA3);
-                    cmuls(mdct_enc[band][4], mdct_enc[band - 1][17 - 4], mdct_enc[band][4], mdct_enc[band - 1][17 - 4],
-                          MDCT_CS4, MDCT_CA4);
-                    cmuls(mdct_enc[band][5], mdct_enc[band - 1][17 - 5], mdct_enc[band][5], mdct_enc[band - 1][17 - 5],
-                          MDCT_CS5, MDCT_CA5);
-                    cmuls(mdct_enc[band][6], mdct_enc[band - 1][17 - 6], mdct_enc[band][6], mdct_enc[band - 1][17 - 6],
-                          MDCT_CS6, MDCT_CA6);
-                    cmuls(mdct_enc[band][7], mdct_enc[band - 1][17 - 7], mdct_enc[band][7], mdct_enc[band - 1][17 - 7],
-                          MDCT_CS7, MDCT_CA7);
-                }
+                shine_mdct_band(mdct_in, &config->mdct, mdct_enc[band], simd);
             }
+
+            /* Perform aliasing reduction butterfly. Each one touches the low half of
+             * a band and the high half of the band below, so they are independent
+             * and can run after all the bands are transformed. */
+            shine_mdct_alias(mdct_enc, simd);
         }
 
         /* Save latest granule's subband samples to be used in the next mdct call */
@@ -2303,21 +2954,16 @@ void shine_mdct_sub(shine_global_config *config, int stride) {
 }
 
 /*
- * shine_subband_initialise:
+ * shine_subband_tables:
  * ----------------------
  * Calculates the analysis filterbank coefficients and rounds to the
  * 9th decimal place accuracy of the filterbank tables in the ISO
  * document.  The coefficients are stored in #filter#
  */
-void shine_subband_initialise(shine_global_config *config) {
+void shine_subband_tables(shine_tables_t *tab) {
     int i, j;
     double filter;
 
-    for (i = MAX_CHANNELS; i--;) {
-        config->subband.off[i] = 0;
-        memset(config->subband.x[i], 0, sizeof(config->subband.x[i]));
-    }
-
     for (i = SBLIMIT; i--;)
         for (j = 64; j--;) {
             if ((filter = 1e9 * cos((double) ((2 * i + 1) * (16 - j) * PI64))) >= 0)
@@ -2325,10 +2971,20 @@ void shine_subband_initialise(shine_global_config *config) {
             else
                 modf(filter - 0.5, &filter);
             /* scale and convert to fixed point before storing */
-            config->subband.fl[i][j] = (int32_t) (filter * (0x7fffffff * 1e-9));
+            tab->fl[i][j] = (int32_t) (filter * (0x7fffffff * 1e-9));
         }
 }
 
+void shine_subband_initialise(shine_global_config *config) {
+    int i;
+
+    for (i = MAX_CHANNELS; i--;) {
+        config->subband.off[i] = 0;
+        memset(config->subband.x[i], 0, sizeof(config->subband.x[i]));
+    }
+    config->subband.fl = shine_get_tables()->fl;
+}
+
 /*
  * shine_window_filter_subband:
  * -------------------------
@@ -2343,64 +2999,186 @@ void shine_subband_initialise(shine_global_config *config) {
  * picking out values from the windowed samples, and then multiplying
  * them by the filter matrix, producing 32 subband samples.
  */
-void
-shine_window_filter_subband(int16_t **buffer, int32_t s[SBLIMIT], int ch, shine_global_config *config, int stride) {
+static void
+shine_window_filter_subband_c(const int32_t *x, int off, const int32_t fl[SBLIMIT][64], int32_t s[SBLIMIT]) {
     int32_t y[64];
     int i, j;
-    int16_t *ptr = *buffer;
-
-    /* replace 32 oldest samples with 32 new samples */
-    for (i = 32; i--;) {
-        config->subband.x[ch][i + config->subband.off[ch]] = ((int32_t) *ptr) << 16;
-        ptr += stride;
-    }
-    *buffer = ptr;
 
     for (i = 64; i--;) {
         int32_t s_value;
         uint32_t s_value_lo __attribute__((unused));
 
-        mul0  (s_value, s_value_lo, config->subband.x[ch][(config->subband.off[ch] + i + (0 << 6)) & (HAN_SIZE - 1)],
+        mul0  (s_value, s_value_lo, x[(off + i + (0 << 6)) & (HAN_SIZE - 1)],
                shine_enwindow[i + (0 << 6)]);
-        muladd(s_value, s_value_lo, config->subband.x[ch][(config->subband.off[ch] + i + (1 << 6)) & (HAN_SIZE - 1)],
+        muladd(s_value, s_value_lo, x[(off + i + (1 << 6)) & (HAN_SIZE - 1)],
                shine_enwindow[i + (1 << 6)]);
-        muladd(s_value, s_value_lo, config->subband.x[ch][(config->subband.off[ch] + i + (2 << 6)) & (HAN_SIZE - 1)],
+        muladd(s_value, s_value_lo, x[(off + i + (2 << 6)) & (HAN_SIZE - 1)],
                shine_enwindow[i + (2 << 6)]);
-        muladd(s_value, s_value_lo, config->subband.x[ch][(config->subband.off[ch] + i + (3 << 6)) & (HAN_SIZE - 1)],
+        muladd(s_value, s_value_lo, x[(off + i + (3 << 6)) & (HAN_SIZE - 1)],
                shine_enwindow[i + (3 << 6)]);
-        muladd(s_value, s_value_lo, config->subband.x[ch][(config->subband.off[ch] + i + (4 << 6)) & (HAN_SIZE - 1)],
+        muladd(s_value, s_value_lo, x[(off + i + (4 << 6)) & (HAN_SIZE - 1)],
                shine_enwindow[i + (4 << 6)]);
-        muladd(s_value, s_value_lo, config->subband.x[ch][(config->subband.off[ch] + i + (5 << 6)) & (HAN_SIZE - 1)],
+        muladd(s_value, s_value_lo, x[(off + i + (5 << 6)) & (HAN_SIZE - 1)],
                shine_enwindow[i + (5 << 6)]);
-        muladd(s_value, s_value_lo, config->subband.x[ch][(config->subband.off[ch] + i + (6 << 6)) & (HAN_SIZE - 1)],
+        muladd(s_value, s_value_lo, x[(off + i + (6 << 6)) & (HAN_SIZE - 1)],
                shine_enwindow[i + (6 << 6)]);
-        muladd(s_value, s_value_lo, config->subband.x[ch][(config->subband.off[ch] + i + (7 << 6)) & (HAN_SIZE - 1)],
+        muladd(s_value, s_value_lo, x[(off + i + (7 << 6)) & (HAN_SIZE - 1)],
                shine_enwindow[i + (7 << 6)]);
         mulz  (s_value, s_value_lo);
         y[i] = s_value;
     }
 
-    config->subband.off[ch] = (config->subband.off[ch] + 480) & (HAN_SIZE - 1); /* offset is modulo (HAN_SIZE)*/
-
     for (i = SBLIMIT; i--;) {
         int32_t s_value;
         uint32_t s_value_lo __attribute__((unused));
 
-        mul0(s_value, s_value_lo, config->subband.fl[i][63], y[63]);
+        mul0(s_value, s_value_lo, fl[i][63], y[63]);
         for (j = 63; j; j -= 7) {
-            muladd(s_value, s_value_lo, config->subband.fl[i][j - 1], y[j - 1]);
-            muladd(s_value, s_value_lo, config->subband.fl[i][j - 2], y[j - 2]);
-            muladd(s_value, s_value_lo, config->subband.fl[i][j - 3], y[j - 3]);
-            muladd(s_value, s_value_lo, config->subband.fl[i][j - 4], y[j - 4]);
-            muladd(s_value, s_value_lo, config->subband.fl[i][j - 5], y[j - 5]);
-            muladd(s_value, s_value_lo, config->subband.fl[i][j - 6], y[j - 6]);
-            muladd(s_value, s_value_lo, config->subband.fl[i][j - 7], y[j - 7]);
+            muladd(s_value, s_value_lo, fl[i][j - 1], y[j - 1]);
+            muladd(s_value, s_value_lo, fl[i][j - 2], y[j - 2]);
+            muladd(s_value, s_value_lo, fl[i][j - 3], y[j - 3]);
+            muladd(s_value, s_value_lo, fl[i][j - 4], y[j - 4]);
+            muladd(s_value, s_value_lo, fl[i][j - 5], y[j - 5]);
+            muladd(s_value, s_value_lo, fl[i][j - 6], y[j - 6]);
+            muladd(s_value, s_value_lo, fl[i][j - 7], y[j - 7]);
         }
         mulz(s_value, s_value_lo);
         s[i] = s_value;
     }
 }
 
+#ifdef SHINE_X86_SIMD
+/* `off` is always a multiple of 32, so 4 or 8 consecutive window positions
+ * starting at a multiple of 4 or 8 never wrap around HAN_SIZE. */
+__attribute__((target("sse4.1")))
+static void
+shine_window_filter_subband_sse41(const int32_t *x, int off, const int32_t fl[SBLIMIT][64], int32_t s[SBLIMIT]) {
+    int32_t y[64];
+    int i, j;
+
+    for (i = 0; i < 64; i += 4) {
+        __m128i acc = _mm_setzero_si128();
+        for (j = 0; j < 8; j++) {
+            __m128i xv = _mm_loadu_si128((const __m128i *) &x[(off + i + (j << 6)) & (HAN_SIZE - 1)]);
+            __m128i wv = _mm_loadu_si128((const __m128i *) &shine_enwindow[i + (j << 6)]);
+            acc = _mm_add_epi32(acc, shine_mul_sse41(xv, wv));
+        }
+        _mm_storeu_si128((__m128i *) &y[i], acc);
+    }
+
+    /* four rows of the matrix at a time, reduced with horizontal adds */
+    for (i = 0; i < SBLIMIT; i += 4) {
+        __m128i acc0 = _mm_setzero_si128(), acc1 = _mm_setzero_si128();
+        __m128i acc2 = _mm_setzero_si128(), acc3 = _mm_setzero_si128();
+        for (j = 0; j < 64; j += 4) {
+            __m128i yv = _mm_loadu_si128((const __m128i *) &y[j]);
+            acc0 = _mm_add_epi32(acc0, shine_mul_sse41(_mm_loadu_si128((const __m128i *) &fl[i][j]), yv));
+            acc1 = _mm_add_epi32(acc1, shine_mul_sse41(_mm_loadu_si128((const __m128i *) &fl[i + 1][j]), yv));
+            acc2 = _mm_add_epi32(acc2, shine_mul_sse41(_mm_loadu_si128((const __m128i *) &fl[i + 2][j]), yv));
+            acc3 = _mm_add_epi32(acc3, shine_mul_sse41(_mm_loadu_si128((const __m128i *) &fl[i + 3][j]), yv));
+        }
+        acc0 = _mm_hadd_epi32(_mm_hadd_epi32(acc0, acc1), _mm_hadd_epi32(acc2, acc3));
+        _mm_storeu_si128((__m128i *) &s[i], acc0);
+    }
+}
+
+__attribute__((target("avx2")))
+static void
+shine_window_filter_subband_avx2(const int32_t *x, int off, const int32_t fl[SBLIMIT][64], int32_t s[SBLIMIT]) {
+    int32_t y[64];
+    int i, j;
+
+    for (i = 0; i < 64; i += 8) {
+        __m256i acc = _mm256_setzero_si256();
+        for (j = 0; j < 8; j++) {
+            __m256i xv = _mm256_loadu_si256((const __m256i *) &x[(off + i + (j << 6)) & (HAN_SIZE - 1)]);
+            __m256i wv = _mm256_loadu_si256((const __m256i *) &shine_enwindow[i + (j << 6)]);
+            acc = _mm256_add_epi32(acc, shine_mul_avx2(xv, wv));
+        }
+        _mm256_storeu_si256((__m256i *) &y[i], acc);
+    }
+
+    for (i = 0; i < SBLIMIT; i += 4) {
+        __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+        __m256i acc2 = _mm256_setzero_si256(), acc3 = _mm256_setzero_si256();
+        for (j = 0; j < 64; j += 8) {
+            __m256i yv = _mm256_loadu_si256((const __m256i *) &y[j]);
+            acc0 = _mm256_add_epi32(acc0, shine_mul_avx2(_mm256_loadu_si256((const __m256i *) &fl[i][j]), yv));
+            acc1 = _mm256_add_epi32(acc1, shine_mul_avx2(_mm256_loadu_si256((const __m256i *) &fl[i + 1][j]), yv));
+            acc2 = _mm256_add_epi32(acc2, shine_mul_avx2(_mm256_loadu_si256((const __m256i *) &fl[i + 2][j]), yv));
+            acc3 = _mm256_add_epi32(acc3, shine_mul_avx2(_mm256_loadu_si256((const __m256i *) &fl[i + 3][j]), yv));
+        }
+        /* hadd works within each 128-bit half, the two halves are added last */
+        acc0 = _mm256_hadd_epi32(_mm256_hadd_epi32(acc0, acc1), _mm256_hadd_epi32(acc2, acc3));
+        _mm_storeu_si128((__m128i *) &s[i],
+                         _mm_add_epi32(_mm256_castsi256_si128(acc0), _mm256_extracti128_si256(acc0, 1)));
+    }
+}
+#endif
+
+/* -1 until the CPU has been probed, then one of shine_simd_t */
+static int shine_simd_level = -1;
+
+shine_simd_t shine_simd_supported(void) {
+#ifdef SHINE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SHINE_SIMD_AVX2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return SHINE_SIMD_SSE41;
+#endif
+    return SHINE_SIMD_NONE;
+}
+
+shine_simd_t shine_get_simd(void) {
+    int level = __atomic_load_n(&shine_simd_level, __ATOMIC_RELAXED);
+    if (level < 0) {
+        level = shine_simd_supported();
+        __atomic_store_n(&shine_simd_level, level, __ATOMIC_RELAXED);
+    }
+    return (shine_simd_t) level;
+}
+
+shine_simd_t shine_set_simd(shine_simd_t level) {
+    shine_simd_t supported = shine_simd_supported();
+    if (level > supported)
+        level = supported;
+    if (level < SHINE_SIMD_NONE)
+        level = SHINE_SIMD_NONE;
+    __atomic_store_n(&shine_simd_level, (int) level, __ATOMIC_RELAXED);
+    return level;
+}
+
+void
+shine_window_filter_subband(int16_t **buffer, int32_t s[SBLIMIT], int ch, shine_global_config *config, int stride) {
+    int i;
+    int off = config->subband.off[ch];
+    int16_t *ptr = *buffer;
+
+    /* replace 32 oldest samples with 32 new samples */
+    for (i = 32; i--;) {
+        config->subband.x[ch][i + off] = ((int32_t) *ptr) << 16;
+        ptr += stride;
+    }
+    *buffer = ptr;
+
+    switch (shine_get_simd()) {
+#ifdef SHINE_X86_SIMD
+        case SHINE_SIMD_AVX2:
+            shine_window_filter_subband_avx2(config->subband.x[ch], off, config->subband.fl, s);
+            break;
+        case SHINE_SIMD_SSE41:
+            shine_window_filter_subband_sse41(config->subband.x[ch], off, config->subband.fl, s);
+            break;
+#endif
+        default:
+            shine_window_filter_subband_c(config->subband.x[ch], off, config->subband.fl, s);
+            break;
+    }
+
+    config->subband.off[ch] = (off + 480) & (HAN_SIZE - 1); /* offset is modulo (HAN_SIZE)*/
+}
+
 
 /*
  * shine_max_reservoir_bits:
@@ -125,6 +125,14 @@ int shine_check_config(int freq, int bitr);
  * the encoder. */
 shine_t shine_initialise(shine_config_t *config);
 
+/* Bring an encoder back to the state `shine_initialise` would return for
+ * `config`, reusing its memory. Meant for encoding a new stream with the same
+ * object; output is identical to a freshly initialised encoder.
+ *
+ * Returns -1 (and leaves the encoder untouched) if the configuration is not
+ * supported, 0 otherwise. */
+int shine_reset(shine_t s, shine_config_t *config);
+
 /* Maximun possible value for the function below. */
 #define SHINE_MAX_SAMPLES 1152
 
@@ -150,9 +158,62 @@ unsigned char *shine_encode_buffer(shine_t s, int16_t **data, int *written);
 unsigned char *shine_encode_buffer_interleaved(shine_t s, int16_t *data, int *written);
 
 /* Flush all data currently in the encoding buffer. Should be used before closing
- * the encoder, to make all encoded data has been written. */
+ * the encoder, to make all encoded data has been written. 
+ *
+ * Called between two frames it also drains the bit cache, so the bytes returned
+ * so far end exactly at a frame boundary and encoding can simply continue. */
 unsigned char *shine_flush(shine_t s, int *written);
 
+/* The padding bit of each frame follows a running slot lag that depends on every
+ * frame encoded before it. These let a frame-parallel encoder start an instance
+ * in the middle of a stream with the same padding as a single instance would use.
+ *
+ * `shine_skip_frames` advances the slot lag as if `frames` frames had been encoded. */
+double shine_get_slot_lag(shine_t s);
+void shine_set_slot_lag(shine_t s, double slot_lag);
+void shine_skip_frames(shine_t s, int frames);
+
+/* Rate control of the quantization loop.
+ *
+ * SHINE_RC_DEFAULT searches the step size of every granule from scratch with
+ * a binary search, then raises it one step at a time until the granule fits.
+ *
+ * SHINE_RC_FAST starts from the step size of the previous granule of the same
+ * channel and brackets/bisects from there. Bit counts of failed trials stop
+ * as soon as the budget is exceeded. The chosen step size can differ slightly
+ * from the default, so the output is not bit-exact with it. Frame-parallel
+ * encoding (separate instances per segment) is not bit-exact with a single
+ * instance in this mode either, since the history restarts at each segment.
+ *
+ * The setting survives shine_reset. */
+typedef enum {
+    SHINE_RC_DEFAULT = 0,
+    SHINE_RC_FAST
+} shine_rate_control_t;
+
+void shine_set_rate_control(shine_t s, shine_rate_control_t rc);
+shine_rate_control_t shine_get_rate_control(shine_t s);
+
+/* SIMD kernels of the analysis filterbank, the MDCT (with its alias reduction)
+ * and the quantization loop (quantize, ix_max, calc_runlen, count_bit),
+ * selected once per process from CPUID. All of them produce the same output as
+ * the generic C code. */
+typedef enum {
+    SHINE_SIMD_NONE = 0,
+    SHINE_SIMD_SSE41,
+    SHINE_SIMD_AVX2
+} shine_simd_t;
+
+/* Best level this CPU supports. */
+shine_simd_t shine_simd_supported(void);
+
+/* Level currently in use, detected on first call. */
+shine_simd_t shine_get_simd(void);
+
+/* Force a level, e.g. SHINE_SIMD_NONE to compare against the C code. It is
+ * clamped to what the CPU supports and the level in use is returned. */
+shine_simd_t shine_set_simd(shine_simd_t level);
+
 /* Close an encoder, freeing all associated memory. Encoder handler is not
  * valid after this call. */
 void shine_close(shine_t s);